@@ -47,6 +47,17 @@ static inline void flush(buffer_t *buffer)
 	buffer->write(buffer, 0);
 }
 
+// Make at least size bytes available from the current position, if the buffer has a read callback.
+static inline size_t fill(buffer_t *buffer, size_t size)
+{
+	if ((buffer->size - buffer->pos) < size && buffer->read != NULL && buffer->error == 0)
+	{
+		buffer->read(buffer, size);
+	}
+
+	return buffer->size - buffer->pos;
+}
+
 static inline uint8_t readbyte(buffer_t *buffer)
 {
 	if (buffer->error)
@@ -56,7 +67,10 @@ static inline uint8_t readbyte(buffer_t *buffer)
 
 	if ((buffer->pos + 1) > buffer->size)
 	{
-		return 0;
+		if (fill(buffer, 1) < 1)
+		{
+			return 0;
+		}
 	}
 
 	return buffer->data[buffer->pos++];
@@ -71,7 +85,10 @@ static inline uint8_t peekbyte(buffer_t *buffer, uint32_t offset)
 
 	if ((buffer->pos + offset) >= buffer->size)
 	{
-		return 0;
+		if (fill(buffer, (size_t)offset + 1) < ((size_t)offset + 1))
+		{
+			return 0;
+		}
 	}
 
 	return buffer->data[buffer->pos + offset];
@@ -107,6 +124,8 @@ static inline size_t writebyte(buffer_t *buffer, uint8_t byte)
 
 static inline size_t writen(buffer_t *buffer, void *in, size_t size)
 {
+	size_t count = 0;
+
 	if (buffer->error)
 	{
 		return 0;
@@ -116,7 +135,16 @@ static inline size_t writen(buffer_t *buffer, void *in, size_t size)
 	{
 		if (buffer->write == NULL)
 		{
-			return 0;
+			// Fixed size buffers, copy what fits.
+			count = buffer->size - buffer->pos;
+
+			if (count != 0)
+			{
+				memcpy(buffer->data + buffer->pos, in, count);
+				buffer->pos += count;
+			}
+
+			return count;
 		}
 
 		buffer->write(buffer, size);
@@ -125,14 +153,66 @@ static inline size_t writen(buffer_t *buffer, void *in, size_t size)
 		{
 			return 0;
 		}
+
+		// Fixed size buffers (streams) may not be able to hold everything at once.
+		while ((buffer->pos + (size - count)) > buffer->size)
+		{
+			size_t part = buffer->size - buffer->pos;
+
+			memcpy(buffer->data + buffer->pos, (uint8_t *)in + count, part);
+			buffer->pos += part;
+			count += part;
+
+			buffer->write(buffer, size - count);
+
+			if (buffer->error)
+			{
+				return count;
+			}
+		}
 	}
 
-	memcpy(buffer->data + buffer->pos, in, size);
-	buffer->pos += size;
+	memcpy(buffer->data + buffer->pos, (uint8_t *)in + count, size - count);
+	buffer->pos += size - count;
 
 	return size;
 }
 
 size_t memory_buffer_write(buffer_t *buffer, size_t size);
 
+// NUL terminated strings of unknown length, the terminator is found lazily as the buffer is read.
+size_t string_buffer_read(buffer_t *buffer, size_t size);
+
+/*
+   Segmented buffers (ropes).
+
+   The output is kept in a chain of fixed size segments instead of one contiguous allocation, so that large outputs
+   are not copied each time they grow. The first chunk is provided by the caller (usually on the stack).
+   Use rope_gather to consume the segments in order, or rope_linearize to get a contiguous copy.
+*/
+
+#define ROPE_SEGMENT_SIZE 65536
+
+typedef struct _rope_segment rope_segment;
+typedef int (*rope_gather_t)(void *context, const void *data, size_t size);
+
+typedef struct _rope_t
+{
+	rope_segment *head;
+	rope_segment *tail;
+	uint8_t *initial;
+	size_t initial_size;
+	size_t length; // bytes in the finished chunks
+} rope_t;
+
+void rope_init(buffer_t *buffer, rope_t *rope, void *initial, size_t size);
+void rope_free(buffer_t *buffer);
+size_t rope_write(buffer_t *buffer, size_t size);
+size_t rope_length(buffer_t *buffer);
+int rope_gather(buffer_t *buffer, rope_gather_t gather, void *context);
+void *rope_linearize(buffer_t *buffer);
+
+// Number of bytes from the current position before the next '%' (or whitespace if spaces is set).
+size_t literal_span(buffer_t *buffer, uint32_t spaces);
+
 #endif
@@ -369,6 +369,7 @@ static inline uint32_t uptr_from_bin(buffer_t *buffer, uintptr_t *value)
 	return count;
 }
 
+uint32_t decimal_digit_count(uintmax_t x);
 uint32_t uint_to_dec_common(uint8_t buffer[32], uintmax_t x, uint32_t flags);
 uint32_t uint_from_dec_common(buffer_t *buffer, uintmax_t *value, uint32_t flags);
 
@@ -615,22 +616,39 @@ static inline uint32_t float32_from_hex(buffer_t *buffer, float *value)
 uint32_t float32_to_hex(uint8_t buffer[64], uint8_t upper, float x);
 uint32_t float64_to_hex(uint8_t buffer[64], uint8_t upper, double x);
 
+// Float to decimal
+#define FLOAT64_MAX_DIGITS 800 // Exact expansion of the smallest subnormal has 767 significant digits
+
+#define FLOAT_FINITE 0
+#define FLOAT_INF    1
+#define FLOAT_NAN    2
+
+#define FLOAT_MODE_SHORTEST    0 // Shortest digits that round trip
+#define FLOAT_MODE_SIGNIFICANT 1 // Round to 'precision' significant digits
+#define FLOAT_MODE_FRACTION    2 // Round to 'precision' digits after the decimal point
+
+typedef struct _float_decimal
+{
+	uint8_t sign;
+	uint8_t special;
+	int32_t exponent; // Decimal exponent of the first digit
+	uint32_t count;   // Number of significant digits (trailing zeros are not stored), 0 for zero
+	uint8_t digits[FLOAT64_MAX_DIGITS];
+} float_decimal;
+
+void float64_to_decimal(float_decimal *decimal, double x, uint32_t mode, uint32_t precision);
+
 static inline uint32_t float64_from_hex(buffer_t *buffer, double *value)
 {
 	return float_from_hex_common(buffer, value);
 }
 
 uint32_t float_from_normal_common(buffer_t *buffer, double *value, uint32_t flags);
+uint32_t float32_from_normal_common(buffer_t *buffer, float *value, uint32_t flags);
 
 static inline uint32_t float32_from_normal(buffer_t *buffer, float *value, uint32_t flags)
 {
-	uint32_t count = 0;
-	double result = 0;
-
-	count = float_from_normal_common(buffer, &result, flags);
-	*value = (float)result;
-
-	return count;
+	return float32_from_normal_common(buffer, value, flags);
 }
 
 static inline uint32_t float64_from_normal(buffer_t *buffer, double *value, uint32_t flags)
@@ -647,5 +665,14 @@ uint32_t utf8_decode(void *buffer, uint8_t size, uint32_t *codepoint);
 uint32_t utf16_encode(uint8_t buffer[32], uint32_t codepoint);
 uint32_t utf16_decode(void *buffer, uint8_t size, uint32_t *codepoint);
 
+/*
+   Bulk transcoding. Sizes are in code units of the respective encodings.
+   Conversion stops at the first invalid sequence or when the next codepoint does not fit in the output.
+   If out is NULL, only the size of the output is computed.
+   Returns the number of units written, and the number of units read in consumed (if not NULL).
+*/
+size_t utf16_to_utf8(const uint16_t *in, size_t size, uint8_t *out, size_t capacity, size_t *consumed);
+size_t utf8_to_utf16(const uint8_t *in, size_t size, uint16_t *out, size_t capacity, size_t *consumed);
+
 
 #endif
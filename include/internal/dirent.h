@@ -9,6 +9,7 @@
 #define WLIBC_DIRENT_INTERNAL_H
 
 #include <internal/nt.h>
+#include <internal/lock.h>
 #include <sys/types.h>
 
 typedef struct _WLIBC_DIR
@@ -30,8 +31,8 @@ typedef struct _WLIBC_DIR
 		return ret;                                          \
 	}
 
-#define LOCK_DIR_STREAM(stream)   RtlEnterCriticalSection(&(stream->critical))
-#define UNLOCK_DIR_STREAM(stream) RtlLeaveCriticalSection(&(stream->critical))
+#define LOCK_DIR_STREAM(stream, locked)   LOCK_CRITICAL_SECTION(&(stream->critical), locked)
+#define UNLOCK_DIR_STREAM(stream, locked) UNLOCK_CRITICAL_SECTION(&(stream->critical), locked)
 
 #define DIRENT_DIR_BUFFER_SIZE 131072 // 128 KB. This allows a minimum of 250 entries.
 
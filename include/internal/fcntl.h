@@ -9,6 +9,7 @@
 #define FCNTL_INTERNAL_H
 
 #include <internal/nt.h>
+#include <internal/lock.h>
 #include <sys/types.h>
 #include <stdbool.h>
 
@@ -30,7 +31,8 @@ typedef struct _fdinfo
 	unsigned int sequence;
 } fdinfo;
 
-extern fdinfo *_wlibc_fd_table;
+// The fd table is a directory of fixed size blocks. Growing the table only adds blocks, entries do not move.
+extern fdinfo **_wlibc_fd_table;
 extern size_t _wlibc_fd_table_size;
 extern unsigned int _wlibc_fd_sequence;
 extern RTL_SRWLOCK _wlibc_fd_table_srwlock;
@@ -61,6 +63,7 @@ int get_fd(HANDLE _h);
 
 // Return information on the fd.
 // If fd given is invalid, type is set to INVALID_HANDLE, and handle is set to NULL.
+// This does not take the fd table lock unless a writer is active.
 void get_fdinfo(int fd, fdinfo *info);
 
 // Getters
@@ -69,7 +72,7 @@ int get_fd_flags(int _fd);
 handle_t get_fd_type(int _fd);
 
 // Setters
-void set_fd_handle(int _fd, HANDLE _handle);
+int set_fd_handle(int _fd, HANDLE _handle);
 void set_fd_flags(int _fd, int _flags);
 void set_fd_type(int _fd, handle_t _type);
 
@@ -92,16 +95,36 @@ HANDLE open_conin(void);
 HANDLE open_conout(void);
 HANDLE open_mountmgr(void);
 
-#define SHARED_LOCK_FD_TABLE()      RtlAcquireSRWLockShared(&_wlibc_fd_table_srwlock)
-#define SHARED_UNLOCK_FD_TABLE()    RtlReleaseSRWLockShared(&_wlibc_fd_table_srwlock)
+// Shared locks are elided while the process is single threaded. Whether the lock was taken is stored in the caller's flag.
+#define SHARED_LOCK_FD_TABLE(locked)                           \
+	do                                                         \
+	{                                                          \
+		*(locked) = THREADS_ACTIVE();                          \
+		if (*(locked))                                         \
+		{                                                      \
+			RtlAcquireSRWLockShared(&_wlibc_fd_table_srwlock); \
+		}                                                      \
+	} while (0)
+#define SHARED_UNLOCK_FD_TABLE(locked)                         \
+	do                                                         \
+	{                                                          \
+		if (locked)                                            \
+		{                                                      \
+			RtlReleaseSRWLockShared(&_wlibc_fd_table_srwlock); \
+		}                                                      \
+	} while (0)
 #define EXCLUSIVE_LOCK_FD_TABLE()   RtlAcquireSRWLockExclusive(&_wlibc_fd_table_srwlock)
 #define EXCLUSIVE_UNLOCK_FD_TABLE() RtlReleaseSRWLockExclusive(&_wlibc_fd_table_srwlock)
 
+#define FD_BLOCK_SHIFT 8
+#define FD_BLOCK_SIZE  (1 << FD_BLOCK_SHIFT)
+#define FD_ENTRY(fd)   (&_wlibc_fd_table[(fd) >> FD_BLOCK_SHIFT][(fd) & (FD_BLOCK_SIZE - 1)])
+
 #define FD_IN_TABLE(fd)     (fd < _wlibc_fd_table_size)
-#define FD_GET_HANDLE(fd)   (_wlibc_fd_table[fd].handle)
-#define FD_GET_TYPE(fd)     (_wlibc_fd_table[fd].type)
-#define FD_GET_FLAGS(fd)    (_wlibc_fd_table[fd].flags)
-#define FD_GET_SEQUENCE(fd) (_wlibc_fd_table[fd].sequence)
+#define FD_GET_HANDLE(fd)   (FD_ENTRY(fd)->handle)
+#define FD_GET_TYPE(fd)     (FD_ENTRY(fd)->type)
+#define FD_GET_FLAGS(fd)    (FD_ENTRY(fd)->flags)
+#define FD_GET_SEQUENCE(fd) (FD_ENTRY(fd)->sequence)
 
 #define VALIDATE_PATH(path, error, ret)  \
 	if (path == NULL || path[0] == '\0') \
@@ -0,0 +1,40 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#ifndef WLIBC_LOCK_INTERNAL_H
+#define WLIBC_LOCK_INTERNAL_H
+
+#include <internal/nt.h>
+
+// Set once a second thread is seen in the process. It is never cleared.
+extern volatile LONG _wlibc_threads_active;
+
+void mark_threads_active(void);
+
+#define THREADS_ACTIVE() (_wlibc_threads_active != 0)
+
+// Locks are elided while the process is single threaded.
+// Whether the lock was taken is stored in the caller's flag, so that a lock elided before a thread was created is not released.
+#define LOCK_CRITICAL_SECTION(critical, locked)   \
+	do                                            \
+	{                                             \
+		*(locked) = THREADS_ACTIVE();             \
+		if (*(locked))                            \
+		{                                         \
+			RtlEnterCriticalSection(critical);    \
+		}                                         \
+	} while (0)
+#define UNLOCK_CRITICAL_SECTION(critical, locked) \
+	do                                            \
+	{                                             \
+		if (locked)                               \
+		{                                         \
+			RtlLeaveCriticalSection(critical);    \
+		}                                         \
+	} while (0)
+
+#endif
@@ -9,8 +9,11 @@
 #define WLIBC_STDIO_INTERNAL_H
 
 #include <internal/nt.h>
+#include <internal/lock.h>
 #include <sys/types.h>
 
+typedef struct _stream_readahead stream_readahead;
+
 typedef struct _WLIBC_FILE
 {
 	unsigned int magic;
@@ -22,11 +25,21 @@ typedef struct _WLIBC_FILE
 	size_t start;
 	size_t end;
 	size_t pos; // ftell
+	size_t base_size; // initial buffer size, 0 if the size was chosen by the user
+	unsigned int full_transfers;
+	ULONGLONG last_transfer;
 	int prev_op;
 	HANDLE phandle;
+	size_t length;   // memory streams, size of the contents
+	char **memptr;   // open_memstream
+	size_t *memsize; // open_memstream
+	stream_readahead *readahead;
+	size_t unread_count;
+	unsigned char unread[16]; // unbuffered streams, lookahead given back by scanf when the fd cannot seek
+	// The members below are kept when a stream is recycled.
 	RTL_CRITICAL_SECTION critical;
-	struct _WLIBC_FILE *prev;
-	struct _WLIBC_FILE *next;
+	struct _WLIBC_FILE *next; // registry, streams are never removed from it
+	SLIST_ENTRY pool;
 } FILE;
 
 /* Buffer options */
@@ -39,8 +52,8 @@ typedef struct _WLIBC_FILE
 		return ret;                                           \
 	}
 
-#define LOCK_FILE_STREAM(stream)   RtlEnterCriticalSection(&(stream->critical))
-#define UNLOCK_FILE_STREAM(stream) RtlLeaveCriticalSection(&(stream->critical))
+#define LOCK_FILE_STREAM(stream, locked)   LOCK_CRITICAL_SECTION(&(stream->critical), locked)
+#define UNLOCK_FILE_STREAM(stream, locked) UNLOCK_CRITICAL_SECTION(&(stream->critical), locked)
 
 #define _IOBUFFER_INTERNAL  0x1
 #define _IOBUFFER_EXTERNAL  0x2
@@ -51,6 +64,10 @@ typedef struct _WLIBC_FILE
 #define _IOBUFFER_WRONLY 0x200 // writes are buffered
 #define _IOBUFFER_RDWR   0x400 // both reads and writes are unbuffered
 
+#define _IOBUFFER_APPEND    0x800  // memory streams, writes go to the end
+#define _IOBUFFER_READAHEAD 0x1000 // sequential reads are overlapped with the next block
+#define _IOBUFFER_MAPPED    0x2000 // read only memory stream over a mapping of the whole file
+
 // Same as public stdio.h
 #define _IOFBF 0x0010 // Full buffering
 #define _IOLBF 0x0020 // line buffering
@@ -64,17 +81,35 @@ typedef struct _WLIBC_FILE
 
 #define FD_MEMSTREAM -1
 
-extern FILE *_wlibc_stdio_head;
-extern RTL_CRITICAL_SECTION _wlibc_stdio_critical;
+// Mapped streams keep their fd, but are read in place like memory streams.
+#define IS_MEMORY_STREAM(stream) ((stream)->fd == FD_MEMSTREAM || ((stream)->buf_mode & _IOBUFFER_MAPPED))
 
-#define LOCK_STDIO()   RtlEnterCriticalSection(&_wlibc_stdio_critical)
-#define UNLOCK_STDIO() RtlLeaveCriticalSection(&_wlibc_stdio_critical)
+// All streams ever created, live or free. Streams are only added to the front.
+extern FILE *volatile _wlibc_stdio_head;
 
 void initialize_stdio(void);
 void cleanup_stdio(void);
 FILE *create_stream(int fd, int buf_mode, int buf_size);
 void delete_stream(FILE *stream);
 
+size_t stream_buffer_size(int fd);
+void adapt_stream_buffer(FILE *stream, size_t transferred);
+
+// Memory streams are read and written in place, the window is always [0, length) for reads and [0, buf_size) for writes.
+int memstream_begin(FILE *stream, int op);
+size_t memstream_reserve(FILE *stream, size_t size);
+size_t memstream_read(void *buffer, size_t size, FILE *stream);
+size_t memstream_write(const void *buffer, size_t size, FILE *stream);
+int memstream_seek(FILE *stream, ssize_t offset, int whence);
+int memstream_flush(FILE *stream);
+FILE *map_stream(int fd);
+void unmap_stream(FILE *stream);
+
+// Read ahead streams read the next block in the background, any other access to the fd stops it first.
+ssize_t readahead_read(FILE *stream, void *buffer, size_t size);
+void readahead_stop(FILE *stream);
+void readahead_free(FILE *stream);
+
 int parse_mode(const char *mode);
 int get_buf_mode(int flags);
 
@@ -15,105 +15,169 @@
 #include <stdint.h>
 #include <string.h>
 
-#define ROUND_UP(x, y)             ((((x) + ((y) - 1)) / (y)) * (y))
-#define VARIADIC_ARGS_DEFAULT_SIZE 64
+#define VARIADIC_ARGS_DEFAULT_SIZE 32
+
+// Argument types
+#define VARIADIC_ARG_INT     1 // int and smaller
+#define VARIADIC_ARG_INT64   2 // 64 bit integers
+#define VARIADIC_ARG_DOUBLE  3 // double, long double
+#define VARIADIC_ARG_POINTER 4
+
+/*
+   Arguments are read directly from the list in order, unless positional arguments are used.
+   For positional arguments the arguments are read once into a table, in a single forward pass with their types.
+   The table lives in the structure itself for upto VARIADIC_ARGS_DEFAULT_SIZE arguments.
+*/
 
 typedef struct _variadic_args
 {
 	va_list list;
+	va_list start;
 	uint32_t current_index;
-	uint32_t read_count;
-	void *args[VARIADIC_ARGS_DEFAULT_SIZE];
-
-	uint32_t extra_capacity;
-	void **extra_args;
+	uint32_t count;
+	uint32_t capacity;
+	uint64_t *values;
+	uint64_t storage[VARIADIC_ARGS_DEFAULT_SIZE];
 } variadic_args;
 
 static void variadic_args_init(variadic_args *args, va_list list)
 {
-	memset(args, 0, sizeof(variadic_args));
 	args->list = list;
+	args->start = list;
+	args->current_index = 0;
+	args->count = 0;
+	args->capacity = 0;
+	args->values = NULL;
 }
 
 static void variadic_args_free(variadic_args *args)
 {
-	if (args->extra_args != NULL)
+	if (args->values != NULL && args->values != args->storage)
+	{
+		free(args->values);
+	}
+}
+
+static uint64_t variadic_args_read(variadic_args *args, uint8_t type)
+{
+	uint64_t value = 0;
+
+	switch (type)
+	{
+	case VARIADIC_ARG_INT:
+		value = (uint64_t)(int64_t)va_arg(args->list, int);
+		break;
+	case VARIADIC_ARG_INT64:
+		value = (uint64_t)va_arg(args->list, int64_t);
+		break;
+	case VARIADIC_ARG_DOUBLE:
 	{
-		free(args->extra_args);
+		double d = va_arg(args->list, double);
+		memcpy(&value, &d, sizeof(double));
 	}
+	break;
+	default:
+		value = (uint64_t)(uintptr_t)va_arg(args->list, void *);
+		break;
+	}
+
+	return value;
 }
 
-static void *variadic_args_get(variadic_args *args, uint32_t index)
+static int variadic_args_reserve(variadic_args *args, uint32_t count)
 {
-	if (index == 0)
+	if (args->values == NULL)
+	{
+		// Start over from the first argument.
+		args->list = args->start;
+		args->values = args->storage;
+		args->capacity = VARIADIC_ARGS_DEFAULT_SIZE;
+	}
+
+	if (count > args->capacity)
 	{
-		// Current index will always be less than or equal to read count
-		if (args->current_index < VARIADIC_ARGS_DEFAULT_SIZE)
+		uint32_t capacity = MAX(args->capacity * 2, count);
+		uint64_t *values = NULL;
+
+		if (args->values == args->storage)
 		{
-			if (args->read_count == args->current_index)
+			values = (uint64_t *)malloc(sizeof(uint64_t) * capacity);
+
+			if (values != NULL)
 			{
-				args->args[args->read_count++] = va_arg(args->list, void *);
+				memcpy(values, args->storage, sizeof(uint64_t) * args->count);
 			}
-
-			return args->args[args->current_index++];
 		}
 		else
 		{
-			if (args->read_count == args->current_index)
-			{
-				if (args->extra_args == NULL || (args->read_count - VARIADIC_ARGS_DEFAULT_SIZE) == args->extra_capacity)
-				{
-					args->extra_capacity = MAX(4, args->extra_capacity * 2);
-					args->extra_args = (void **)realloc(args->extra_args, sizeof(void *) * args->extra_capacity);
-
-					if (args->extra_args == NULL)
-					{
-						return NULL;
-					}
-				}
-
-				args->extra_args[args->read_count++ - VARIADIC_ARGS_DEFAULT_SIZE] = va_arg(args->list, void *);
-			}
-
-			return args->extra_args[args->current_index++ - VARIADIC_ARGS_DEFAULT_SIZE];
+			values = (uint64_t *)realloc(args->values, sizeof(uint64_t) * capacity);
 		}
-	}
 
-	if (index <= VARIADIC_ARGS_DEFAULT_SIZE)
-	{
-		// Read the args upto index
-		for (uint32_t i = args->read_count; i < index; ++i)
+		if (values == NULL)
 		{
-			args->args[args->read_count++] = va_arg(args->list, void *);
+			return -1;
 		}
 
-		return args->args[index - 1];
+		args->values = values;
+		args->capacity = capacity;
 	}
 
-	// Read the args into the static storage first
-	for (uint32_t i = args->read_count; i < VARIADIC_ARGS_DEFAULT_SIZE; ++i)
+	return 0;
+}
+
+// Read all the arguments with their types. Positions with no type (type 0) are read as pointers.
+static int variadic_args_load(variadic_args *args, const uint8_t *types, uint32_t count)
+{
+	if (variadic_args_reserve(args, count) == -1)
 	{
-		args->args[args->read_count++] = va_arg(args->list, void *);
+		return -1;
 	}
 
-	if (args->extra_args == NULL || (index - VARIADIC_ARGS_DEFAULT_SIZE) > args->extra_capacity)
+	for (uint32_t i = args->count; i < count; ++i)
 	{
-		args->extra_capacity = MAX(4, ROUND_UP(index - VARIADIC_ARGS_DEFAULT_SIZE, 4));
-		args->extra_args = (void **)realloc(args->extra_args, sizeof(void *) * args->extra_capacity);
+		args->values[args->count++] = variadic_args_read(args, types[i]);
+	}
+
+	return 0;
+}
+
+static void *variadic_args_get(variadic_args *args, uint32_t index, uint8_t type)
+{
+	uint64_t value = 0;
+	void *result = NULL;
 
-		if (args->extra_args == NULL)
+	if (index == 0 && args->values == NULL)
+	{
+		args->current_index++;
+		value = variadic_args_read(args, type);
+	}
+	else
+	{
+		if (index == 0)
 		{
-			return NULL;
+			index = ++args->current_index;
 		}
-	}
 
-	// Read upto index args in extra space
-	for (uint32_t i = args->read_count; i < index; ++i)
-	{
-		args->extra_args[args->read_count++ - VARIADIC_ARGS_DEFAULT_SIZE] = va_arg(args->list, void *);
+		// Read the arguments upto index (all of the same type).
+		if (index > args->count)
+		{
+			if (variadic_args_reserve(args, index) == -1)
+			{
+				return NULL;
+			}
+
+			while (args->count < index)
+			{
+				args->values[args->count++] = variadic_args_read(args, type);
+			}
+		}
+
+		value = args->values[index - 1];
 	}
 
-	return args->extra_args[index - VARIADIC_ARGS_DEFAULT_SIZE - 1];
+	memcpy(&result, &value, sizeof(void *));
+
+	return result;
 }
 
 #endif
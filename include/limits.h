@@ -75,6 +75,9 @@
 #define LLONG_WIDTH  64
 #define ULLONG_WIDTH 64
 
+// Maximum number of segments in a vectored I/O call.
+#define IOV_MAX 1024
+
 #include <posix/limits.h>
 
 #endif
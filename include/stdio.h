@@ -372,6 +372,61 @@ WLIBC_INLINE char *asnprintf(char *restrict buffer, size_t *size, const char *re
 	return result;
 }
 
+// printf (precompiled formats)
+typedef struct _printf_program printf_program;
+
+WLIBC_API printf_program *wlibc_printf_compile(const char *format);
+WLIBC_API void wlibc_printf_free(printf_program *program);
+WLIBC_API int wlibc_vsnprintf_compiled(char *restrict buffer, size_t size, const printf_program *restrict program, va_list args);
+WLIBC_API int wlibc_vfprintf_compiled(FILE *restrict stream, const printf_program *restrict program, va_list args);
+
+WLIBC_INLINE printf_program *printf_compile(const char *format)
+{
+	return wlibc_printf_compile(format);
+}
+
+WLIBC_INLINE void printf_free(printf_program *program)
+{
+	wlibc_printf_free(program);
+}
+
+WLIBC_INLINE int vsnprintf_compiled(char *restrict buffer, size_t size, const printf_program *restrict program, va_list args)
+{
+	return wlibc_vsnprintf_compiled(buffer, size, program, args);
+}
+
+WLIBC_INLINE int vfprintf_compiled(FILE *restrict stream, const printf_program *restrict program, va_list args)
+{
+	return wlibc_vfprintf_compiled(stream, program, args);
+}
+
+WLIBC_INLINE int snprintf_compiled(char *restrict buffer, size_t size, const printf_program *restrict program, ...)
+{
+	va_list args;
+	va_start(args, program);
+	int result = wlibc_vsnprintf_compiled(buffer, size, program, args);
+	va_end(args);
+	return result;
+}
+
+WLIBC_INLINE int fprintf_compiled(FILE *restrict stream, const printf_program *restrict program, ...)
+{
+	va_list args;
+	va_start(args, program);
+	int result = wlibc_vfprintf_compiled(stream, program, args);
+	va_end(args);
+	return result;
+}
+
+WLIBC_INLINE int printf_compiled(const printf_program *restrict program, ...)
+{
+	va_list args;
+	va_start(args, program);
+	int result = wlibc_vfprintf_compiled(stdout, program, args);
+	va_end(args);
+	return result;
+}
+
 // scanf
 WLIBC_API int wlibc_vsscanf(const char *restrict str, const char *restrict format, va_list args);
 WLIBC_API int wlibc_vfscanf(FILE *restrict stream, const char *restrict format, va_list args);
@@ -487,8 +542,18 @@ WLIBC_INLINE int renameat2(int olddirfd, const char *restrict oldname, int newdi
 }
 
 // memstream
-WLIBC_API FILE *wlibc_fmemopen(void *restrict, size_t, const char *restrict);
-WLIBC_API FILE *wlibc_open_memstream(char **, size_t *);
+WLIBC_API FILE *wlibc_fmemopen(void *restrict buffer, size_t size, const char *restrict mode);
+WLIBC_API FILE *wlibc_open_memstream(char **ptr, size_t *size);
+
+WLIBC_INLINE FILE *fmemopen(void *restrict buffer, size_t size, const char *restrict mode)
+{
+	return wlibc_fmemopen(buffer, size, mode);
+}
+
+WLIBC_INLINE FILE *open_memstream(char **ptr, size_t *size)
+{
+	return wlibc_open_memstream(ptr, size);
+}
 
 // Unlocked
 
@@ -23,6 +23,7 @@ typedef struct _WLIBC_FILE FILE;
 WLIBC_API int wlibc_fbufmode(FILE *stream);
 WLIBC_API size_t wlibc_fbufsize(FILE *stream);
 WLIBC_API const char *wlibc_freadptr(FILE *stream, size_t *bufsize);
+WLIBC_API const char *wlibc_fbufptr(FILE *stream, size_t *size);
 
 WLIBC_INLINE size_t __fbufsize(FILE *stream)
 {
@@ -54,6 +55,12 @@ WLIBC_INLINE const char *__freadptr(FILE *stream, size_t *bufsize)
 	return wlibc_freadptr(stream, bufsize);
 }
 
+// Unread buffered bytes, use __freadptrinc to consume them.
+WLIBC_INLINE const char *__fbufptr(FILE *stream, size_t *size)
+{
+	return wlibc_fbufptr(stream, size);
+}
+
 // Mode query
 WLIBC_API int wlibc_freading(FILE *stream);
 WLIBC_API int wlibc_fwriting(FILE *stream);
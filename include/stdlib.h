@@ -268,11 +268,8 @@ _ACRTIMP int __cdecl _atoflt_l(_CRT_FLOAT *_Result, char const *str, _locale_t l
 _ACRTIMP int __cdecl _atodbl_l(_CRT_DOUBLE *_Result, char *str, _locale_t locale);
 _ACRTIMP int __cdecl _atoldbl_l(_LDOUBLE *_Result, char *str, _locale_t locale);
 
-_ACRTIMP float __cdecl strtof(char const *str, char **_EndPtr);
 _ACRTIMP float __cdecl _strtof_l(char const *str, char **_EndPtr, _locale_t locale);
-_ACRTIMP double __cdecl strtod(char const *str, char **_EndPtr);
 _ACRTIMP double __cdecl _strtod_l(char const *str, char **_EndPtr, _locale_t locale);
-_ACRTIMP long double __cdecl strtold(char const *str, char **_EndPtr);
 _ACRTIMP long double __cdecl _strtold_l(char const *str, char **_EndPtr, _locale_t locale);
 
 _ACRTIMP long __cdecl strtol(char const *str, char **_EndPtr, int radix);
@@ -483,6 +480,36 @@ WLIBC_INLINE int wsetenv(const wchar_t *restrict name, const wchar_t *restrict v
 	return wlibc_wsetenv(name, value, overwrite);
 }
 
+WLIBC_API double wlibc_strtod(const char *restrict str, char **restrict end);
+WLIBC_API float wlibc_strtof(const char *restrict str, char **restrict end);
+WLIBC_API double wlibc_strntod(const char *restrict str, size_t length, char **restrict end);
+WLIBC_API float wlibc_strntof(const char *restrict str, size_t length, char **restrict end);
+
+WLIBC_INLINE double strtod(const char *restrict str, char **restrict end)
+{
+	return wlibc_strtod(str, end);
+}
+
+WLIBC_INLINE float strtof(const char *restrict str, char **restrict end)
+{
+	return wlibc_strtof(str, end);
+}
+
+WLIBC_INLINE long double strtold(const char *restrict str, char **restrict end)
+{
+	return wlibc_strtod(str, end);
+}
+
+WLIBC_INLINE double strntod(const char *restrict str, size_t length, char **restrict end)
+{
+	return wlibc_strntod(str, length, end);
+}
+
+WLIBC_INLINE float strntof(const char *restrict str, size_t length, char **restrict end)
+{
+	return wlibc_strntof(str, length, end);
+}
+
 WLIBC_API int wlibc_unsetenv(const char *name);
 WLIBC_API int wlibc_wunsetenv(const wchar_t *name);
 
@@ -0,0 +1,73 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#ifndef WLIBC_SYS_UIO_H
+#define WLIBC_SYS_UIO_H
+
+#include <wlibc.h>
+#include <limits.h>
+#include <sys/types.h>
+
+_WLIBC_BEGIN_DECLS
+
+struct iovec
+{
+	void *iov_base; // Start of the segment.
+	size_t iov_len; // Length of the segment.
+};
+
+#define UIO_MAXIOV IOV_MAX
+
+/* Flags for preadv2, pwritev2 */
+#define RWF_HIPRI  0x1  // Ignored.
+#define RWF_DSYNC  0x2  // Flush the data after writing.
+#define RWF_SYNC   0x4  // Flush the data and metadata after writing.
+#define RWF_NOWAIT 0x8  // Unsupported.
+#define RWF_APPEND 0x10 // Write at the end of the file, the offset is ignored.
+
+WLIBC_API ssize_t wlibc_readv(int fd, const struct iovec *iov, int iovcnt);
+WLIBC_API ssize_t wlibc_writev(int fd, const struct iovec *iov, int iovcnt);
+
+WLIBC_INLINE ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	return wlibc_readv(fd, iov, iovcnt);
+}
+
+WLIBC_INLINE ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	return wlibc_writev(fd, iov, iovcnt);
+}
+
+WLIBC_API ssize_t wlibc_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+WLIBC_API ssize_t wlibc_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+WLIBC_INLINE ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+	return wlibc_preadv(fd, iov, iovcnt, offset);
+}
+
+WLIBC_INLINE ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+	return wlibc_pwritev(fd, iov, iovcnt, offset);
+}
+
+WLIBC_API ssize_t wlibc_preadv2(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags);
+WLIBC_API ssize_t wlibc_pwritev2(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags);
+
+WLIBC_INLINE ssize_t preadv2(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags)
+{
+	return wlibc_preadv2(fd, iov, iovcnt, offset, flags);
+}
+
+WLIBC_INLINE ssize_t pwritev2(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags)
+{
+	return wlibc_pwritev2(fd, iov, iovcnt, offset, flags);
+}
+
+_WLIBC_END_DECLS
+
+#endif
@@ -11,9 +11,10 @@
 int wlibc_dirfd(DIR *dirstream)
 {
 	int fd;
+	BOOLEAN locked;
 	VALIDATE_DIR_STREAM(dirstream, -1);
-	LOCK_DIR_STREAM(dirstream);
+	LOCK_DIR_STREAM(dirstream, &locked);
 	fd = dirstream->fd;
-	UNLOCK_DIR_STREAM(dirstream);
+	UNLOCK_DIR_STREAM(dirstream, locked);
 	return fd;
 }
@@ -6,6 +6,7 @@
 */
 
 #include <internal/nt.h>
+#include <internal/convert.h>
 #include <internal/dirent.h>
 #include <internal/error.h>
 #include <internal/fcntl.h>
@@ -17,8 +18,9 @@ struct dirent *do_readdir(DIR *dirstream, struct dirent *entry)
 {
 	NTSTATUS status;
 	IO_STATUS_BLOCK io;
-	UTF8_STRING u8_path;
-	UNICODE_STRING u16_path;
+	size_t length = 0;
+	size_t size = 0;
+	size_t consumed = 0;
 
 	if (dirstream->read_data == dirstream->received_data)
 	{
@@ -68,25 +70,19 @@ struct dirent *do_readdir(DIR *dirstream, struct dirent *entry)
 
 	entry->d_reclen = (uint16_t)(offsetof(FILE_ID_EXTD_BOTH_DIR_INFORMATION, FileName) + direntry->FileNameLength);
 
-	u16_path.Length = (USHORT)direntry->FileNameLength;
-	u16_path.MaximumLength = (USHORT)direntry->FileNameLength;
-	u16_path.Buffer = direntry->FileName;
+	length = direntry->FileNameLength / sizeof(WCHAR);
+	size = utf16_to_utf8((const uint16_t *)direntry->FileName, length, (uint8_t *)entry->d_name, sizeof(entry->d_name) - 1, &consumed);
 
-	u8_path.Buffer = entry->d_name;
-	u8_path.Length = 0;
-	u8_path.MaximumLength = 260;
-
-	status = RtlUnicodeStringToUTF8String(&u8_path, &u16_path, FALSE);
-
-	if (status == STATUS_SUCCESS)
+	if (consumed == length)
 	{
-		memcpy(entry->d_name, u8_path.Buffer, u8_path.MaximumLength);
-		entry->d_namlen = (uint8_t)u8_path.Length; // This does not include the NULL character.
+		entry->d_name[size] = '\0';
+		entry->d_namlen = (uint8_t)size; // This does not include the NULL character.
 	}
 	else
 	{
 		// Converting the UTF-16 name to UTF-8 has failed. Treat as if the entry has no name.
 		// This really should never happen.
+		entry->d_name[0] = '\0';
 		entry->d_namlen = 0;
 	}
 
@@ -103,14 +99,16 @@ struct dirent *do_readdir(DIR *dirstream, struct dirent *entry)
 
 struct dirent *wlibc_readdir(DIR *dirstream)
 {
+	BOOLEAN locked;
+
 	VALIDATE_DIR_STREAM(dirstream, NULL);
 
 	static struct dirent entry;
 	struct dirent *result;
 
-	LOCK_DIR_STREAM(dirstream);
+	LOCK_DIR_STREAM(dirstream, &locked);
 	result = do_readdir(dirstream, &entry);
-	UNLOCK_DIR_STREAM(dirstream);
+	UNLOCK_DIR_STREAM(dirstream, locked);
 
 	return result;
 }
@@ -14,12 +14,14 @@
 
 void wlibc_rewinddir(DIR *dirstream)
 {
+	BOOLEAN locked;
+
 	VALIDATE_DIR_STREAM(dirstream, );
 
 	NTSTATUS status;
 	IO_STATUS_BLOCK io;
 
-	LOCK_DIR_STREAM(dirstream);
+	LOCK_DIR_STREAM(dirstream, &locked);
 
 	memset(dirstream->buffer, 0, DIRENT_DIR_BUFFER_SIZE);
 	status = NtQueryDirectoryFileEx(get_fd_handle(dirstream->fd), NULL, NULL, NULL, &io, dirstream->buffer, DIRENT_DIR_BUFFER_SIZE,
@@ -33,5 +35,5 @@ void wlibc_rewinddir(DIR *dirstream)
 	dirstream->read_data = 0;
 	dirstream->offset = 0;
 
-	UNLOCK_DIR_STREAM(dirstream);
+	UNLOCK_DIR_STREAM(dirstream, locked);
 }
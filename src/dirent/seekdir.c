@@ -13,9 +13,11 @@
 
 void wlibc_seekdir(DIR *dirstream, long long int pos)
 {
+	BOOLEAN locked;
+
 	VALIDATE_DIR_STREAM(dirstream, );
-	LOCK_DIR_STREAM(dirstream);
+	LOCK_DIR_STREAM(dirstream, &locked);
 	// This value should be given by telldir
 	dirstream->offset = pos;
-	UNLOCK_DIR_STREAM(dirstream);
+	UNLOCK_DIR_STREAM(dirstream, locked);
 }
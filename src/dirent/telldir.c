@@ -13,14 +13,15 @@
 off_t wlibc_telldir(DIR *dirstream)
 {
 	off_t offset;
+	BOOLEAN locked;
 	VALIDATE_DIR_STREAM(dirstream, -1);
 
-	LOCK_DIR_STREAM(dirstream);
+	LOCK_DIR_STREAM(dirstream, &locked);
 	// Return the offset in DIR->buffer.
 	// NOTE: This is actually not the file offset in the directory entry.
 	// You should treat this strictly as an opaque value.
 	offset = dirstream->offset;
-	UNLOCK_DIR_STREAM(dirstream);
+	UNLOCK_DIR_STREAM(dirstream, locked);
 
 	return offset;
 }
@@ -8,32 +8,347 @@
 #include <internal/nt.h>
 #include <internal/error.h>
 #include <internal/fcntl.h>
+#include <internal/minmax.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <intrin.h>
 
-fdinfo *_wlibc_fd_table = NULL;
+fdinfo **_wlibc_fd_table = NULL;
 size_t _wlibc_fd_table_size = 0;
+static size_t _wlibc_fd_directory_size = 0;
 unsigned int _wlibc_fd_sequence = 0;
 RTL_SRWLOCK _wlibc_fd_table_srwlock;
 
+// Free slots of the fd table. A bit of the summary is set if the corresponding word has a free slot.
+static uint64_t *_wlibc_fd_free = NULL;
+static uint64_t *_wlibc_fd_free_summary = NULL;
+static size_t _wlibc_fd_free_words = 0;
+
+// Reverse index of the fd table, handle -> fd. Open addressing with linear probing, empty slots have a NULL handle.
+typedef struct _fd_index_entry
+{
+	HANDLE handle;
+	int fd;
+} fd_index_entry;
+
+static fd_index_entry *_wlibc_fd_index = NULL;
+static size_t _wlibc_fd_index_size = 0;
+static size_t _wlibc_fd_index_count = 0;
+
+// Sequence count of the fd table, odd while a writer is changing it. Readers retry (or lock) if it changed under them.
+static volatile LONG _wlibc_fd_table_seqcount = 0;
+
+// Block directories replaced by a larger one. Readers without the lock can still be looking at them, free them at exit.
+// Each growth doubles the directory, so there can be no more of these than bits in an int.
+static fdinfo **_wlibc_fd_retired_directories[32];
+static int _wlibc_fd_retired_count = 0;
+
+#define FD_TABLE_WRITE_BEGIN() _InterlockedIncrement(&_wlibc_fd_table_seqcount)
+#define FD_TABLE_WRITE_END()   _InterlockedIncrement(&_wlibc_fd_table_seqcount)
+
+// Loads are not reordered with other loads on x86.
+#if defined(_M_IX86) || defined(_M_AMD64)
+#define FD_TABLE_READ_BARRIER() _ReadWriteBarrier()
+#else
+#define FD_TABLE_READ_BARRIER() MemoryBarrier()
+#endif
+
 // Declaration of static functions
 static int internal_insert_fd(int index, HANDLE _h, handle_t _type, int _flags);
 static int register_to_fd_table_internal(HANDLE _h, handle_t _type, int _flags);
 static int insert_into_fd_table_internal(int _fd, HANDLE _h, handle_t _type, int _flags);
 static void unregister_from_fd_table_internal(HANDLE _h);
 static int get_fd_internal(HANDLE _h);
+static int grow_fd_table(size_t size);
+static int fd_block_reserve(size_t fd);
 static int close_fd_internal(int _fd);
 
 static HANDLE get_fd_handle_internal(int _fd);
 static int get_fd_flags_internal(int _fd);
 static handle_t get_fd_type_internal(int _fd);
 
-static void set_fd_handle_internal(int _fd, HANDLE _handle);
+static int set_fd_handle_internal(int _fd, HANDLE _handle);
 static void set_fd_flags_internal(int _fd, int _flags);
 static void set_fd_type_internal(int _fd, handle_t _type);
 static void add_fd_flags_internal(int _fd, int _flags);
 
 static bool validate_fd_internal(int _fd);
+static bool validate_fd_in_table(fdinfo **table, size_t size, int _fd);
+
+///////////////////////////////////////
+// Free slot bitmap
+///////////////////////////////////////
+#define FD_BITMAP_WORDS(size) (((size) + 63) / 64)
+
+static unsigned long fd_bit_scan(uint64_t word)
+{
+	unsigned long index = 0;
+
+#ifdef _WIN64
+	_BitScanForward64(&index, word);
+#else
+	if ((uint32_t)word != 0)
+	{
+		_BitScanForward(&index, (uint32_t)word);
+	}
+	else
+	{
+		_BitScanForward(&index, (uint32_t)(word >> 32));
+		index += 32;
+	}
+#endif
+
+	return index;
+}
+
+static void fd_mark_free(size_t fd)
+{
+	_wlibc_fd_free[fd / 64] |= 1ull << (fd % 64);
+	_wlibc_fd_free_summary[fd / 4096] |= 1ull << ((fd / 64) % 64);
+}
+
+static void fd_mark_used(size_t fd)
+{
+	_wlibc_fd_free[fd / 64] &= ~(1ull << (fd % 64));
+
+	if (_wlibc_fd_free[fd / 64] == 0)
+	{
+		_wlibc_fd_free_summary[fd / 4096] &= ~(1ull << ((fd / 64) % 64));
+	}
+}
+
+// Mark all the slots of the blocks [first, last) free. Blocks that are not allocated yet only have free slots.
+static void fd_mark_free_blocks(size_t first, size_t last)
+{
+	for (size_t word = first * (FD_BLOCK_SIZE / 64); word < last * (FD_BLOCK_SIZE / 64); ++word)
+	{
+		_wlibc_fd_free[word] = ~0ull;
+		_wlibc_fd_free_summary[word / 64] |= 1ull << (word % 64);
+	}
+}
+
+// Return the lowest free slot, -1 if the table is full.
+static int fd_lowest_free(void)
+{
+	size_t summary_words = FD_BITMAP_WORDS(_wlibc_fd_free_words);
+
+	for (size_t i = 0; i < summary_words; ++i)
+	{
+		if (_wlibc_fd_free_summary[i] != 0)
+		{
+			size_t word = (i * 64) + fd_bit_scan(_wlibc_fd_free_summary[i]);
+			return (int)((word * 64) + fd_bit_scan(_wlibc_fd_free[word]));
+		}
+	}
+
+	return -1;
+}
+
+// Make room for a table of 'size' slots. The new slots are not marked free here.
+static int fd_bitmap_reserve(size_t size)
+{
+	size_t words = FD_BITMAP_WORDS(size);
+	size_t old_summary_words = FD_BITMAP_WORDS(_wlibc_fd_free_words);
+	size_t summary_words = FD_BITMAP_WORDS(words);
+	uint64_t *free_words = NULL, *summary = NULL;
+
+	if (words <= _wlibc_fd_free_words)
+	{
+		return 0;
+	}
+
+	if (_wlibc_fd_free == NULL)
+	{
+		free_words = (uint64_t *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(uint64_t) * words);
+		summary = (uint64_t *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(uint64_t) * summary_words);
+	}
+	else
+	{
+		free_words = (uint64_t *)RtlReAllocateHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_free, sizeof(uint64_t) * words);
+		summary = (uint64_t *)RtlReAllocateHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_free_summary, sizeof(uint64_t) * summary_words);
+	}
+
+	// Keep whatever was reallocated, the old contents are still valid.
+	if (free_words != NULL)
+	{
+		_wlibc_fd_free = free_words;
+	}
+	if (summary != NULL)
+	{
+		_wlibc_fd_free_summary = summary;
+	}
+
+	if (free_words == NULL || summary == NULL)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	memset(_wlibc_fd_free + _wlibc_fd_free_words, 0, sizeof(uint64_t) * (words - _wlibc_fd_free_words));
+	memset(_wlibc_fd_free_summary + old_summary_words, 0, sizeof(uint64_t) * (summary_words - old_summary_words));
+
+	_wlibc_fd_free_words = words;
+
+	return 0;
+}
+
+///////////////////////////////////////
+// Handle index
+///////////////////////////////////////
+#define FD_INDEX_INITIAL_SIZE 16
+
+static size_t fd_index_hash(HANDLE handle)
+{
+	// Handles are multiples of 4, Fibonacci hashing spreads the rest.
+	return (size_t)((((uint64_t)(uintptr_t)handle >> 2) * 0x9E3779B97F4A7C15ull) >> 32) & (_wlibc_fd_index_size - 1);
+}
+
+static void fd_index_place(HANDLE handle, int fd)
+{
+	size_t slot = fd_index_hash(handle);
+
+	while (_wlibc_fd_index[slot].handle != NULL)
+	{
+		slot = (slot + 1) & (_wlibc_fd_index_size - 1);
+	}
+
+	_wlibc_fd_index[slot].handle = handle;
+	_wlibc_fd_index[slot].fd = fd;
+}
+
+// Keep the load factor at or below 1/2 for 'count' entries.
+static int fd_index_reserve(size_t count)
+{
+	fd_index_entry *old_index = _wlibc_fd_index;
+	size_t old_size = _wlibc_fd_index_size;
+	size_t size = old_size == 0 ? FD_INDEX_INITIAL_SIZE : old_size;
+
+	while (size < count * 2)
+	{
+		size *= 2;
+	}
+
+	if (size == old_size)
+	{
+		return 0;
+	}
+
+	_wlibc_fd_index = (fd_index_entry *)RtlAllocateHeap(NtCurrentProcessHeap(), HEAP_ZERO_MEMORY, sizeof(fd_index_entry) * size);
+
+	if (_wlibc_fd_index == NULL)
+	{
+		_wlibc_fd_index = old_index;
+		errno = ENOMEM;
+		return -1;
+	}
+
+	_wlibc_fd_index_size = size;
+
+	for (size_t i = 0; i < old_size; ++i)
+	{
+		if (old_index[i].handle != NULL)
+		{
+			fd_index_place(old_index[i].handle, old_index[i].fd);
+		}
+	}
+
+	RtlFreeHeap(NtCurrentProcessHeap(), 0, old_index);
+
+	return 0;
+}
+
+// Callers reserve before changing the table, so that this can not fail once the fd is published.
+static int fd_index_add(HANDLE handle, int fd)
+{
+	if (handle == NULL || handle == INVALID_HANDLE_VALUE)
+	{
+		return 0;
+	}
+
+	if (fd_index_reserve(_wlibc_fd_index_count + 1) == -1)
+	{
+		return -1;
+	}
+
+	fd_index_place(handle, fd);
+	++_wlibc_fd_index_count;
+
+	return 0;
+}
+
+// Return the slot of the lowest fd referring to the handle, -1 if there is none.
+static ssize_t fd_index_find(HANDLE handle)
+{
+	ssize_t result = -1;
+	size_t slot;
+
+	if (_wlibc_fd_index_count == 0 || handle == NULL || handle == INVALID_HANDLE_VALUE)
+	{
+		return -1;
+	}
+
+	// The same handle can be in more than one fd.
+	for (slot = fd_index_hash(handle); _wlibc_fd_index[slot].handle != NULL; slot = (slot + 1) & (_wlibc_fd_index_size - 1))
+	{
+		if (_wlibc_fd_index[slot].handle == handle && (result == -1 || _wlibc_fd_index[slot].fd < _wlibc_fd_index[result].fd))
+		{
+			result = slot;
+		}
+	}
+
+	return result;
+}
+
+static void fd_index_remove_slot(size_t slot)
+{
+	size_t mask = _wlibc_fd_index_size - 1;
+	size_t next = slot;
+
+	// Shift back the entries that probed past this slot, so that lookups do not stop early.
+	while (1)
+	{
+		size_t home;
+
+		next = (next + 1) & mask;
+
+		if (_wlibc_fd_index[next].handle == NULL)
+		{
+			break;
+		}
+
+		home = fd_index_hash(_wlibc_fd_index[next].handle);
+
+		if (((next - home) & mask) >= ((next - slot) & mask))
+		{
+			_wlibc_fd_index[slot] = _wlibc_fd_index[next];
+			slot = next;
+		}
+	}
+
+	_wlibc_fd_index[slot].handle = NULL;
+	--_wlibc_fd_index_count;
+}
+
+static void fd_index_remove(HANDLE handle, int fd)
+{
+	size_t slot;
+
+	if (_wlibc_fd_index_count == 0 || handle == NULL || handle == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	for (slot = fd_index_hash(handle); _wlibc_fd_index[slot].handle != NULL; slot = (slot + 1) & (_wlibc_fd_index_size - 1))
+	{
+		if (_wlibc_fd_index[slot].handle == handle && _wlibc_fd_index[slot].fd == fd)
+		{
+			fd_index_remove_slot(slot);
+			return;
+		}
+	}
+}
 
 handle_t determine_handle_type(HANDLE handle)
 {
@@ -197,23 +512,23 @@ void initialize_std_handles(HANDLE handle, int index, bool console_subsystem, bo
 	inherited_handle_type = determine_handle_type(handle);
 	if (inherited_handle_type != INVALID_HANDLE)
 	{
-		_wlibc_fd_table[index].handle = handle;
-		_wlibc_fd_table[index].type = inherited_handle_type;
-		_wlibc_fd_table[index].flags = determine_handle_flags(handle);
-		_wlibc_fd_table[index].sequence = ++_wlibc_fd_sequence;
+		FD_ENTRY(index)->handle = handle;
+		FD_ENTRY(index)->type = inherited_handle_type;
+		FD_ENTRY(index)->flags = determine_handle_flags(handle);
+		FD_ENTRY(index)->sequence = ++_wlibc_fd_sequence;
 	}
 	else if (console_subsystem)
 	{
-		_wlibc_fd_table[index].handle = output == true ? open_conout() : open_conin();
-		if (_wlibc_fd_table[index].handle != NULL)
+		FD_ENTRY(index)->handle = output == true ? open_conout() : open_conin();
+		if (FD_ENTRY(index)->handle != NULL)
 		{
-			_wlibc_fd_table[index].type = CONSOLE_HANDLE;
-			_wlibc_fd_table[index].flags = output == true ? O_WRONLY : O_RDONLY;
-			_wlibc_fd_table[index].sequence = ++_wlibc_fd_sequence;
+			FD_ENTRY(index)->type = CONSOLE_HANDLE;
+			FD_ENTRY(index)->flags = output == true ? O_WRONLY : O_RDONLY;
+			FD_ENTRY(index)->sequence = ++_wlibc_fd_sequence;
 		}
 		else
 		{
-			_wlibc_fd_table[index].handle = NULL;
+			FD_ENTRY(index)->handle = NULL;
 		}
 	}
 }
@@ -253,25 +568,19 @@ void init_fd_table(void)
 	// This first 4 bytes say the number of handles inherited.
 	DWORD number_of_handles_inherited = data->Buffer == NULL ? 0 : *(DWORD *)data->Buffer;
 
-	_wlibc_fd_table_size = 4;
-	// Set the initial size of the fd tables to be the nearest 2 power enough to fit in all the handles.
-	while (_wlibc_fd_table_size < number_of_handles_inherited)
-	{
-		_wlibc_fd_table_size *= 2;
-	}
-
-	_wlibc_fd_table = (fdinfo *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(fdinfo) * _wlibc_fd_table_size);
-
+	// Allocate enough blocks to fit in all the handles. All handles are marked invalid at the start.
 	// Exit the process if the initialization routine fails.
-	if (_wlibc_fd_table == NULL)
+	if (grow_fd_table(MAX(number_of_handles_inherited, 3)) == -1)
 	{
 		RtlExitUserProcess(STATUS_NO_MEMORY);
 	}
 
-	// Mark all handles as invalid at the start.
-	for (size_t i = 0; i < _wlibc_fd_table_size; ++i)
+	for (size_t i = 0; i < _wlibc_fd_table_size; i += FD_BLOCK_SIZE)
 	{
-		_wlibc_fd_table[i].handle = NULL;
+		if (fd_block_reserve(i) == -1)
+		{
+			RtlExitUserProcess(STATUS_NO_MEMORY);
+		}
 	}
 
 	// Standard Input,Output,Error.
@@ -293,22 +602,36 @@ void init_fd_table(void)
 			// msvcrt sets invalid handles to INVALID_HANDLE_VALUE to inherited processes.
 			if ((handle_flag & FOPEN_FLAG) == 0 || inherited_handle == INVALID_HANDLE_VALUE)
 			{
-				_wlibc_fd_table[i].handle = NULL;
+				FD_ENTRY(i)->handle = NULL;
 				continue;
 			}
 
 			inherited_handle_type = determine_handle_type(inherited_handle);
 			if (inherited_handle_type == INVALID_HANDLE)
 			{
-				_wlibc_fd_table[i].handle = NULL;
+				FD_ENTRY(i)->handle = NULL;
 				continue;
 			}
 
 			// Valid handle. Don't trust the other flags that are passed, query the kernel for the actual values.
-			_wlibc_fd_table[i].handle = inherited_handle;
-			_wlibc_fd_table[i].flags = determine_handle_flags(inherited_handle);
-			_wlibc_fd_table[i].type = inherited_handle_type;
-			_wlibc_fd_table[i].sequence = ++_wlibc_fd_sequence;
+			FD_ENTRY(i)->handle = inherited_handle;
+			FD_ENTRY(i)->flags = determine_handle_flags(inherited_handle);
+			FD_ENTRY(i)->type = inherited_handle_type;
+			FD_ENTRY(i)->sequence = ++_wlibc_fd_sequence;
+		}
+	}
+
+	if (fd_index_reserve(_wlibc_fd_table_size) == -1)
+	{
+		RtlExitUserProcess(STATUS_NO_MEMORY);
+	}
+
+	for (size_t i = 0; i < _wlibc_fd_table_size; ++i)
+	{
+		if (FD_ENTRY(i)->handle != NULL)
+		{
+			fd_mark_used(i);
+			fd_index_add(FD_ENTRY(i)->handle, (int)i);
 		}
 	}
 }
@@ -316,7 +639,123 @@ void init_fd_table(void)
 // Not worrying about open handles (not closed by the user)
 void cleanup_fd_table(void)
 {
+	for (size_t i = 0; i < _wlibc_fd_table_size / FD_BLOCK_SIZE; ++i)
+	{
+		if (_wlibc_fd_table[i] != NULL)
+		{
+			RtlFreeHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_table[i]);
+		}
+	}
+
 	RtlFreeHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_table);
+	RtlFreeHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_free);
+	RtlFreeHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_free_summary);
+	RtlFreeHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_index);
+
+	_wlibc_fd_free = NULL;
+	_wlibc_fd_free_summary = NULL;
+	_wlibc_fd_free_words = 0;
+
+	_wlibc_fd_index = NULL;
+	_wlibc_fd_index_size = 0;
+	_wlibc_fd_index_count = 0;
+
+	for (int i = 0; i < _wlibc_fd_retired_count; ++i)
+	{
+		RtlFreeHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_retired_directories[i]);
+	}
+
+	_wlibc_fd_table = NULL;
+	_wlibc_fd_table_size = 0;
+	_wlibc_fd_directory_size = 0;
+	_wlibc_fd_retired_count = 0;
+}
+
+// Extend the table to at least 'size' slots. Entries never move, only the directory is copied when it grows.
+// The blocks are allocated on their first use, so that a large fd does not allocate all the blocks below it.
+static int grow_fd_table(size_t size)
+{
+	size_t blocks = _wlibc_fd_table_size / FD_BLOCK_SIZE;
+	size_t new_blocks = (size + FD_BLOCK_SIZE - 1) / FD_BLOCK_SIZE;
+
+	if (new_blocks <= blocks)
+	{
+		return 0;
+	}
+
+	if (fd_bitmap_reserve(new_blocks * FD_BLOCK_SIZE) == -1)
+	{
+		return -1;
+	}
+
+	if (new_blocks > _wlibc_fd_directory_size)
+	{
+		size_t directory_size = _wlibc_fd_directory_size == 0 ? 4 : _wlibc_fd_directory_size;
+		fdinfo **directory = NULL;
+
+		while (directory_size < new_blocks)
+		{
+			directory_size *= 2;
+		}
+
+		directory = (fdinfo **)RtlAllocateHeap(NtCurrentProcessHeap(), HEAP_ZERO_MEMORY, sizeof(fdinfo *) * directory_size);
+
+		if (directory == NULL)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+
+		// Readers without the lock may still be using the old directory, do not free it yet.
+		if (_wlibc_fd_table != NULL)
+		{
+			memcpy(directory, _wlibc_fd_table, sizeof(fdinfo *) * blocks);
+
+			if (_wlibc_fd_retired_count < (int)ARRAYSIZE(_wlibc_fd_retired_directories))
+			{
+				_wlibc_fd_retired_directories[_wlibc_fd_retired_count++] = _wlibc_fd_table;
+			}
+		}
+
+		WritePointerRelease((PVOID *)&_wlibc_fd_table, directory);
+		_wlibc_fd_directory_size = directory_size;
+	}
+
+	fd_mark_free_blocks(blocks, new_blocks);
+
+	// Lockless readers load the size first, publish it only after the directory.
+	WriteULongPtrRelease((ULONG_PTR *)&_wlibc_fd_table_size, new_blocks * FD_BLOCK_SIZE);
+
+	return 0;
+}
+
+static int fd_block_reserve(size_t fd)
+{
+	size_t index = fd >> FD_BLOCK_SHIFT;
+	fdinfo *block = NULL;
+
+	if (_wlibc_fd_table[index] != NULL)
+	{
+		return 0;
+	}
+
+	block = (fdinfo *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(fdinfo) * FD_BLOCK_SIZE);
+
+	if (block == NULL)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for (size_t j = 0; j < FD_BLOCK_SIZE; ++j)
+	{
+		block[j].handle = NULL;
+	}
+
+	// Lockless readers see either no block or an initialized one.
+	WritePointerRelease((PVOID *)&_wlibc_fd_table[index], block);
+
+	return 0;
 }
 
 ///////////////////////////////////////
@@ -325,10 +764,15 @@ void cleanup_fd_table(void)
 
 static int internal_insert_fd(int index, HANDLE _h, handle_t _type, int _flags)
 {
-	_wlibc_fd_table[index].handle = _h;
-	_wlibc_fd_table[index].flags = _flags;
-	_wlibc_fd_table[index].type = _type;
-	_wlibc_fd_table[index].sequence = ++_wlibc_fd_sequence;
+	fd_index_remove(FD_ENTRY(index)->handle, index);
+	fd_index_add(_h, index);
+
+	FD_ENTRY(index)->handle = _h;
+	FD_ENTRY(index)->flags = _flags;
+	FD_ENTRY(index)->type = _type;
+	FD_ENTRY(index)->sequence = ++_wlibc_fd_sequence;
+
+	fd_mark_used(index);
 
 	switch (index)
 	{
@@ -350,78 +794,62 @@ static int internal_insert_fd(int index, HANDLE _h, handle_t _type, int _flags)
 
 static int register_to_fd_table_internal(HANDLE _h, handle_t _type, int _flags)
 {
-	bool is_there_free_space = false;
-	int index = -1;
-	int fd = -1;
-	for (size_t i = 0; i < _wlibc_fd_table_size; i++)
-	{
-		if (_wlibc_fd_table[i].handle == NULL)
-		{
-			is_there_free_space = true;
-			index = (int)i;
-			break;
-		}
-	}
+	int index;
 
-	if (is_there_free_space)
+	if (fd_index_reserve(_wlibc_fd_index_count + 1) == -1)
 	{
-		fd = internal_insert_fd(index, _h, _type, _flags);
+		return -1;
 	}
 
-	else // double the table size
-	{
-		void *temp = (fdinfo *)RtlReAllocateHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_table, sizeof(fdinfo) * _wlibc_fd_table_size * 2);
-		if (temp == NULL)
-		{
-			errno = ENOMEM;
-			return -1;
-		}
-
-		_wlibc_fd_table = temp;
+	index = fd_lowest_free();
 
-		fd = internal_insert_fd((int)_wlibc_fd_table_size, _h, _type, _flags);
+	if (index == -1) // add a block
+	{
+		index = (int)_wlibc_fd_table_size;
 
-		for (size_t i = _wlibc_fd_table_size + 1; i < _wlibc_fd_table_size * 2; i++)
+		if (grow_fd_table(_wlibc_fd_table_size + 1) == -1)
 		{
-			_wlibc_fd_table[i].handle = NULL;
+			return -1;
 		}
+	}
 
-		_wlibc_fd_table_size *= 2;
+	if (fd_block_reserve(index) == -1)
+	{
+		return -1;
 	}
 
-	return fd;
+	return internal_insert_fd(index, _h, _type, _flags);
 }
 
 int register_to_fd_table(HANDLE _h, handle_t _type, int _flags)
 {
 	EXCLUSIVE_LOCK_FD_TABLE();
+	FD_TABLE_WRITE_BEGIN();
 	int fd = register_to_fd_table_internal(_h, _type, _flags);
+	FD_TABLE_WRITE_END();
 	EXCLUSIVE_UNLOCK_FD_TABLE();
 	return fd;
 }
 
 static int insert_into_fd_table_internal(int _fd, HANDLE _h, handle_t _type, int _flags)
 {
+	if (fd_index_reserve(_wlibc_fd_index_count + 1) == -1)
+	{
+		return -1;
+	}
+
 	// grow the table
 	if (_fd >= (int)_wlibc_fd_table_size)
 	{
-		void *temp = (fdinfo *)RtlReAllocateHeap(NtCurrentProcessHeap(), 0, _wlibc_fd_table,
-												 sizeof(fdinfo) * _fd * 2); // Allocate double the requested fd number
-
-		if (temp == NULL)
+		if (grow_fd_table((size_t)_fd + 1) == -1)
 		{
-			errno = ENOMEM;
 			return -1;
 		}
+	}
 
-		_wlibc_fd_table = temp;
-
-		for (int i = (int)_wlibc_fd_table_size; i < _fd * 2; ++i)
-		{
-			_wlibc_fd_table[i].handle = NULL;
-		}
-
-		_wlibc_fd_table_size = _fd * 2;
+	if (fd_block_reserve(_fd) == -1)
+	{
+		return -1;
 	}
 
 	internal_insert_fd(_fd, _h, _type, _flags);
@@ -432,64 +860,78 @@ int insert_into_fd_table(int _fd, HANDLE _h, handle_t _type, int _flags)
 {
 	int fd;
 	EXCLUSIVE_LOCK_FD_TABLE();
+	FD_TABLE_WRITE_BEGIN();
 	fd = insert_into_fd_table_internal(_fd, _h, _type, _flags);
+	FD_TABLE_WRITE_END();
 	EXCLUSIVE_UNLOCK_FD_TABLE();
 	return fd;
 }
 
 static void unregister_from_fd_table_internal(HANDLE _h)
 {
-	for (size_t i = 0; i < _wlibc_fd_table_size; i++)
+	ssize_t slot = fd_index_find(_h);
+	int fd;
+
+	if (slot == -1)
 	{
-		if (_wlibc_fd_table[i].handle != INVALID_HANDLE_VALUE && _wlibc_fd_table[i].handle == _h)
-		{
-			// Calling this function after the handle has been closed
-			_wlibc_fd_table[i].handle = NULL;
-			break;
-		}
+		return;
 	}
+
+	// Calling this function after the handle has been closed
+	fd = _wlibc_fd_index[slot].fd;
+	fd_index_remove_slot(slot);
+
+	FD_ENTRY(fd)->handle = NULL;
+	fd_mark_free(fd);
 }
 
 void unregister_from_fd_table(HANDLE _h)
 {
 	EXCLUSIVE_LOCK_FD_TABLE();
+	FD_TABLE_WRITE_BEGIN();
 	unregister_from_fd_table_internal(_h);
+	FD_TABLE_WRITE_END();
 	EXCLUSIVE_UNLOCK_FD_TABLE();
 }
 
 static int get_fd_internal(HANDLE _h)
 {
-	for (size_t i = 0; i < _wlibc_fd_table_size; i++)
+	ssize_t slot = fd_index_find(_h);
+
+	if (slot == -1)
 	{
-		if (_wlibc_fd_table[i].handle != INVALID_HANDLE_VALUE && _h == _wlibc_fd_table[i].handle)
-		{
-			return (int)i;
-		}
+		errno = EBADF;
+		return -1;
 	}
 
-	errno = EBADF;
-	return -1;
+	return _wlibc_fd_index[slot].fd;
 }
 
 int get_fd(HANDLE _h)
 {
-	SHARED_LOCK_FD_TABLE();
+	BOOLEAN locked;
+
+	SHARED_LOCK_FD_TABLE(&locked);
 	int fd = get_fd_internal(_h);
-	SHARED_UNLOCK_FD_TABLE();
+	SHARED_UNLOCK_FD_TABLE(locked);
 	return fd;
 }
 
 static int close_fd_internal(int _fd)
 {
-	NTSTATUS status = NtClose(_wlibc_fd_table[_fd].handle);
+	NTSTATUS status = NtClose(FD_ENTRY(_fd)->handle);
 	if (status != STATUS_SUCCESS)
 	{
 		map_ntstatus_to_errno(status);
 		return -1;
 	}
 	// Closing the file descriptor. Mark the handle as invalid, so we can reuse the same fd again.
-	_wlibc_fd_table[_fd].handle = NULL;
-	_wlibc_fd_table[_fd].type = INVALID_HANDLE;
+	FD_TABLE_WRITE_BEGIN();
+	fd_index_remove(FD_ENTRY(_fd)->handle, _fd);
+	FD_ENTRY(_fd)->handle = NULL;
+	FD_ENTRY(_fd)->type = INVALID_HANDLE;
+	fd_mark_free(_fd);
+	FD_TABLE_WRITE_END();
 	return 0;
 }
 
@@ -506,36 +948,38 @@ int close_fd(int _fd)
 ///////////////////////////////////////
 static HANDLE get_fd_handle_internal(int _fd)
 {
-	return _wlibc_fd_table[_fd].handle;
+	return FD_ENTRY(_fd)->handle;
 }
 
 HANDLE get_fd_handle(int _fd)
 {
 	HANDLE handle;
-	SHARED_LOCK_FD_TABLE();
+	BOOLEAN locked;
+	SHARED_LOCK_FD_TABLE(&locked);
 	handle = get_fd_handle_internal(_fd);
-	SHARED_UNLOCK_FD_TABLE();
+	SHARED_UNLOCK_FD_TABLE(locked);
 	return handle;
 }
 
 static int get_fd_flags_internal(int _fd)
 {
-	return _wlibc_fd_table[_fd].flags;
+	return FD_ENTRY(_fd)->flags;
 }
 
 int get_fd_flags(int _fd)
 {
 	int flags;
-	SHARED_LOCK_FD_TABLE();
+	BOOLEAN locked;
+	SHARED_LOCK_FD_TABLE(&locked);
 	flags = get_fd_flags_internal(_fd);
-	SHARED_UNLOCK_FD_TABLE();
+	SHARED_UNLOCK_FD_TABLE(locked);
 	return flags;
 }
 
 static handle_t get_fd_type_internal(int _fd)
 {
 	if (validate_fd_internal(_fd))
-		return _wlibc_fd_table[_fd].type;
+		return FD_ENTRY(_fd)->type;
 	else
 		return INVALID_HANDLE;
 }
@@ -543,97 +987,162 @@ static handle_t get_fd_type_internal(int _fd)
 handle_t get_fd_type(int _fd)
 {
 	handle_t type;
-	SHARED_LOCK_FD_TABLE();
+	BOOLEAN locked;
+	SHARED_LOCK_FD_TABLE(&locked);
 	type = get_fd_type_internal(_fd);
-	SHARED_UNLOCK_FD_TABLE();
+	SHARED_UNLOCK_FD_TABLE(locked);
 	return type;
 }
 
-void get_fdinfo(int fd, fdinfo *info)
+static void get_fdinfo_internal(fdinfo **table, size_t size, int fd, fdinfo *info)
 {
-	SHARED_LOCK_FD_TABLE();
-
-	if (validate_fd_internal(fd))
+	if (validate_fd_in_table(table, size, fd))
 	{
-		memcpy(info, &_wlibc_fd_table[fd], sizeof(fdinfo));
+		memcpy(info, &table[fd >> FD_BLOCK_SHIFT][fd & (FD_BLOCK_SIZE - 1)], sizeof(fdinfo));
 	}
 	else
 	{
 		info->handle = NULL;
 		info->type = INVALID_HANDLE;
 	}
+}
+
+void get_fdinfo(int fd, fdinfo *info)
+{
+	LONG sequence = ReadAcquire(&_wlibc_fd_table_seqcount);
+	BOOLEAN locked;
+
+	// Read without the lock. A torn copy is discarded if a writer was seen.
+	if ((sequence & 1) == 0)
+	{
+		// Load the size before the directory, any directory published after it covers the size.
+		size_t size = (size_t)ReadULongPtrAcquire((ULONG_PTR *)&_wlibc_fd_table_size);
+		fdinfo **table = (fdinfo **)ReadPointerAcquire((PVOID *)&_wlibc_fd_table);
+
+		get_fdinfo_internal(table, size, fd, info);
+		FD_TABLE_READ_BARRIER();
+
+		if (_wlibc_fd_table_seqcount == sequence)
+		{
+			return;
+		}
+	}
 
-	SHARED_UNLOCK_FD_TABLE();
+	// Wait for the writer instead of spinning.
+	SHARED_LOCK_FD_TABLE(&locked);
+	get_fdinfo_internal(_wlibc_fd_table, _wlibc_fd_table_size, fd, info);
+	SHARED_UNLOCK_FD_TABLE(locked);
 }
 
 ///////////////////////////////////////
 // Setters
 ///////////////////////////////////////
-static void set_fd_handle_internal(int _fd, HANDLE _handle)
+static int set_fd_handle_internal(int _fd, HANDLE _handle)
 {
-	_wlibc_fd_table[_fd].handle = _handle;
+	if (fd_index_reserve(_wlibc_fd_index_count + 1) == -1)
+	{
+		return -1;
+	}
+
+	fd_index_remove(FD_ENTRY(_fd)->handle, _fd);
+	fd_index_add(_handle, _fd);
+
+	FD_ENTRY(_fd)->handle = _handle;
+
+	if (_handle == NULL)
+	{
+		fd_mark_free(_fd);
+	}
+	else
+	{
+		fd_mark_used(_fd);
+	}
+
+	return 0;
 }
 
-void set_fd_handle(int _fd, HANDLE _handle)
+int set_fd_handle(int _fd, HANDLE _handle)
 {
+	int result;
 	EXCLUSIVE_LOCK_FD_TABLE();
-	set_fd_handle_internal(_fd, _handle);
+	FD_TABLE_WRITE_BEGIN();
+	result = set_fd_handle_internal(_fd, _handle);
+	FD_TABLE_WRITE_END();
 	EXCLUSIVE_UNLOCK_FD_TABLE();
+	return result;
 }
 
 static void set_fd_flags_internal(int _fd, int _flags)
 {
-	_wlibc_fd_table[_fd].flags = _flags;
+	FD_ENTRY(_fd)->flags = _flags;
 }
 
 void set_fd_flags(int _fd, int _flags)
 {
 	EXCLUSIVE_LOCK_FD_TABLE();
+	FD_TABLE_WRITE_BEGIN();
 	set_fd_flags_internal(_fd, _flags);
+	FD_TABLE_WRITE_END();
 	EXCLUSIVE_UNLOCK_FD_TABLE();
 }
 
 static void set_fd_type_internal(int _fd, handle_t _type)
 {
-	_wlibc_fd_table[_fd].type = _type;
+	FD_ENTRY(_fd)->type = _type;
 }
 
 void set_fd_type(int _fd, handle_t _type)
 {
 	EXCLUSIVE_LOCK_FD_TABLE();
+	FD_TABLE_WRITE_BEGIN();
 	set_fd_type_internal(_fd, _type);
+	FD_TABLE_WRITE_END();
 	EXCLUSIVE_UNLOCK_FD_TABLE();
 }
 
 static void add_fd_flags_internal(int _fd, int _flags)
 {
-	_wlibc_fd_table[_fd].flags |= _flags;
+	FD_ENTRY(_fd)->flags |= _flags;
 }
 
 void add_fd_flags(int _fd, int _flags)
 {
 	EXCLUSIVE_LOCK_FD_TABLE();
+	FD_TABLE_WRITE_BEGIN();
 	add_fd_flags_internal(_fd, _flags);
+	FD_TABLE_WRITE_END();
 	EXCLUSIVE_UNLOCK_FD_TABLE();
 }
 
 ///////////////////////////////////////
 // Validators
 ///////////////////////////////////////
-static bool validate_fd_internal(int _fd)
+static bool validate_fd_in_table(fdinfo **table, size_t size, int _fd)
 {
-	if (_fd < 0 || _fd >= (int)_wlibc_fd_table_size)
+	fdinfo *block;
+
+	if (_fd < 0 || _fd >= (int)size)
+		return false;
+	// Blocks are allocated on their first use.
+	block = (fdinfo *)ReadPointerAcquire((PVOID *)&table[_fd >> FD_BLOCK_SHIFT]);
+	if (block == NULL)
 		return false;
-	if (_wlibc_fd_table[_fd].handle == NULL)
+	if (block[_fd & (FD_BLOCK_SIZE - 1)].handle == NULL)
 		return false;
 	return true;
 }
 
+static bool validate_fd_internal(int _fd)
+{
+	return validate_fd_in_table(_wlibc_fd_table, _wlibc_fd_table_size, _fd);
+}
+
 bool validate_fd(int _fd)
 {
 	bool condition = false;
-	SHARED_LOCK_FD_TABLE();
+	BOOLEAN locked;
+	SHARED_LOCK_FD_TABLE(&locked);
 	condition = validate_fd_internal(_fd);
-	SHARED_UNLOCK_FD_TABLE();
+	SHARED_UNLOCK_FD_TABLE(locked);
 	return condition;
 }
@@ -5,10 +5,17 @@
    Refer to the LICENSE file at the root directory for details.
 */
 
+#include <internal/nt.h>
 #include <internal/buffer.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _M_AMD64
+#	include <intrin.h>
+#	include <immintrin.h>
+#	pragma intrinsic(_BitScanForward)
+#endif
+
 size_t memory_buffer_write(buffer_t *buffer, size_t size)
 {
 	size_t old_size = buffer->size;
@@ -66,3 +73,331 @@ size_t memory_buffer_write(buffer_t *buffer, size_t size)
 
 	return buffer->size;
 }
+
+#define STRING_BUFFER_CHUNK_SIZE 256
+
+size_t string_buffer_read(buffer_t *buffer, size_t size)
+{
+	size_t length = 0;
+
+	// Extend the buffer in chunks upto the terminator.
+	while ((buffer->size - buffer->pos) < size)
+	{
+		length = strnlen((const char *)buffer->data + buffer->size, STRING_BUFFER_CHUNK_SIZE);
+		buffer->size += length;
+
+		if (length < STRING_BUFFER_CHUNK_SIZE)
+		{
+			// Terminator found, the buffer is fixed from now on.
+			buffer->read = NULL;
+			break;
+		}
+	}
+
+	return buffer->size - buffer->pos;
+}
+
+#define ROPE_SEGMENT_POOL_DEPTH 16
+
+struct _rope_segment
+{
+	SLIST_ENTRY entry; // Should be the first member (alignment)
+	rope_segment *next;
+	size_t size;
+	uint8_t data[ROPE_SEGMENT_SIZE];
+};
+
+// Free segments are shared by all threads, upto a maximum of ROPE_SEGMENT_POOL_DEPTH segments.
+static SLIST_HEADER rope_segment_pool;
+
+static rope_segment *rope_segment_allocate(void)
+{
+	rope_segment *segment = (rope_segment *)RtlInterlockedPopEntrySList(&rope_segment_pool);
+
+	if (segment == NULL)
+	{
+		segment = (rope_segment *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(rope_segment));
+
+		if (segment == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	segment->next = NULL;
+	segment->size = 0;
+
+	return segment;
+}
+
+static void rope_segment_release(rope_segment *segment)
+{
+	if (RtlQueryDepthSList(&rope_segment_pool) < ROPE_SEGMENT_POOL_DEPTH)
+	{
+		RtlInterlockedPushEntrySList(&rope_segment_pool, &segment->entry);
+		return;
+	}
+
+	RtlFreeHeap(NtCurrentProcessHeap(), 0, segment);
+}
+
+static void rope_sync(buffer_t *buffer)
+{
+	rope_t *rope = (rope_t *)buffer->ctx;
+
+	if (rope->tail == NULL)
+	{
+		rope->initial_size = buffer->pos;
+	}
+	else
+	{
+		rope->tail->size = buffer->pos;
+	}
+}
+
+void rope_init(buffer_t *buffer, rope_t *rope, void *initial, size_t size)
+{
+	memset(rope, 0, sizeof(rope_t));
+	memset(buffer, 0, sizeof(buffer_t));
+
+	rope->initial = initial;
+
+	buffer->data = initial;
+	buffer->size = size;
+	buffer->ctx = rope;
+	buffer->write = rope_write;
+}
+
+void rope_free(buffer_t *buffer)
+{
+	rope_t *rope = (rope_t *)buffer->ctx;
+	rope_segment *segment = rope->head;
+
+	while (segment != NULL)
+	{
+		rope_segment *next = segment->next;
+
+		rope_segment_release(segment);
+		segment = next;
+	}
+
+	rope->head = NULL;
+	rope->tail = NULL;
+	rope->length = 0;
+
+	buffer->data = rope->initial;
+	buffer->pos = 0;
+	buffer->size = 0;
+}
+
+size_t rope_write(buffer_t *buffer, size_t size)
+{
+	rope_t *rope = (rope_t *)buffer->ctx;
+	rope_segment *segment = NULL;
+
+	if (buffer->error)
+	{
+		return 0;
+	}
+
+	if (size == 0)
+	{
+		// nop
+		return 0;
+	}
+
+	segment = rope_segment_allocate();
+
+	if (segment == NULL)
+	{
+		buffer->error = 1;
+		return 0;
+	}
+
+	// Finish the current chunk and start a new segment.
+	rope_sync(buffer);
+	rope->length += buffer->pos;
+
+	if (rope->tail == NULL)
+	{
+		rope->head = segment;
+	}
+	else
+	{
+		rope->tail->next = segment;
+	}
+
+	rope->tail = segment;
+
+	buffer->data = segment->data;
+	buffer->pos = 0;
+	buffer->size = ROPE_SEGMENT_SIZE;
+
+	return buffer->size;
+}
+
+size_t rope_length(buffer_t *buffer)
+{
+	rope_t *rope = (rope_t *)buffer->ctx;
+
+	return rope->length + buffer->pos;
+}
+
+int rope_gather(buffer_t *buffer, rope_gather_t gather, void *context)
+{
+	rope_t *rope = (rope_t *)buffer->ctx;
+	rope_segment *segment = rope->head;
+
+	rope_sync(buffer);
+
+	if (rope->initial_size != 0)
+	{
+		if (gather(context, rope->initial, rope->initial_size) == -1)
+		{
+			return -1;
+		}
+	}
+
+	while (segment != NULL)
+	{
+		if (segment->size != 0)
+		{
+			if (gather(context, segment->data, segment->size) == -1)
+			{
+				return -1;
+			}
+		}
+
+		segment = segment->next;
+	}
+
+	return 0;
+}
+
+static int rope_copy(void *context, const void *data, size_t size)
+{
+	uint8_t **out = (uint8_t **)context;
+
+	memcpy(*out, data, size);
+	*out += size;
+
+	return 0;
+}
+
+void *rope_linearize(buffer_t *buffer)
+{
+	uint8_t *result = NULL;
+	uint8_t *out = NULL;
+	size_t length = rope_length(buffer);
+
+	// Copy each segment once, along with a terminating NULL.
+	result = malloc(length + 1);
+
+	if (result != NULL)
+	{
+		out = result;
+		rope_gather(buffer, rope_copy, &out);
+		result[length] = '\0';
+	}
+
+	rope_free(buffer);
+
+	return result;
+}
+
+static size_t literal_span_scalar(const uint8_t *data, size_t size, uint32_t spaces)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (data[i] == '%')
+		{
+			return i;
+		}
+
+		if (spaces && (data[i] == ' ' || (data[i] >= '\t' && data[i] <= '\r')))
+		{
+			return i;
+		}
+	}
+
+	return size;
+}
+
+size_t literal_span(buffer_t *buffer, uint32_t spaces)
+{
+	const uint8_t *data = buffer->data + buffer->pos;
+	size_t size = buffer->size - buffer->pos;
+	size_t count = 0;
+
+#ifdef _M_AMD64
+	unsigned long index = 0;
+	uint32_t mask = 0;
+
+	// Whitespace is ' ' or [\t-\r]. The latter is checked with an unsigned range compare (x - '\t' <= 4).
+#	ifdef __AVX2__
+	{
+		const __m256i percent = _mm256_set1_epi8('%');
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		const __m256i range = _mm256_set1_epi8('\r' - '\t');
+
+		while (size - count >= 32)
+		{
+			__m256i chunk = _mm256_loadu_si256((const __m256i *)(data + count));
+			__m256i match = _mm256_cmpeq_epi8(chunk, percent);
+
+			if (spaces)
+			{
+				__m256i offset = _mm256_sub_epi8(chunk, tab);
+
+				match = _mm256_or_si256(match, _mm256_cmpeq_epi8(chunk, space));
+				match = _mm256_or_si256(match, _mm256_cmpeq_epi8(_mm256_min_epu8(offset, range), offset));
+			}
+
+			mask = (uint32_t)_mm256_movemask_epi8(match);
+
+			if (mask != 0)
+			{
+				_BitScanForward(&index, mask);
+				return count + index;
+			}
+
+			count += 32;
+		}
+	}
+#	endif
+
+	{
+		const __m128i percent = _mm_set1_epi8('%');
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i range = _mm_set1_epi8('\r' - '\t');
+
+		while (size - count >= 16)
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i *)(data + count));
+			__m128i match = _mm_cmpeq_epi8(chunk, percent);
+
+			if (spaces)
+			{
+				__m128i offset = _mm_sub_epi8(chunk, tab);
+
+				match = _mm_or_si128(match, _mm_cmpeq_epi8(chunk, space));
+				match = _mm_or_si128(match, _mm_cmpeq_epi8(_mm_min_epu8(offset, range), offset));
+			}
+
+			mask = (uint32_t)_mm_movemask_epi8(match);
+
+			if (mask != 0)
+			{
+				_BitScanForward(&index, mask);
+				return count + index;
+			}
+
+			count += 16;
+		}
+	}
+#endif
+
+	return count + literal_span_scalar(data + count, size - count, spaces);
+}
@@ -0,0 +1,56 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#include <internal/nt.h>
+#include <internal/lock.h>
+
+volatile LONG _wlibc_threads_active = 0;
+
+void mark_threads_active(void)
+{
+	if (_wlibc_threads_active == 0)
+	{
+		InterlockedExchange(&_wlibc_threads_active, 1);
+	}
+}
+
+// Threads not created by us (CreateThread, thread pools, console control handlers) are caught here.
+static void NTAPI threads_tls_callback(PVOID module, DWORD reason, PVOID reserved)
+{
+	UNREFERENCED_PARAMETER(module);
+	UNREFERENCED_PARAMETER(reserved);
+
+	switch (reason)
+	{
+	case DLL_THREAD_ATTACH:
+		mark_threads_active();
+		break;
+#ifdef WLIBC_DLL
+	case DLL_PROCESS_ATTACH:
+		// When loaded dynamically other threads might already exist.
+		if (reserved == NULL)
+		{
+			mark_threads_active();
+		}
+		break;
+#endif
+	default:
+		break;
+	}
+}
+
+#ifdef _M_IX86
+#	pragma comment(linker, "/INCLUDE:__tls_used")
+#	pragma comment(linker, "/INCLUDE:__wlibc_threads_tls_callback")
+#else
+#	pragma comment(linker, "/INCLUDE:_tls_used")
+#	pragma comment(linker, "/INCLUDE:_wlibc_threads_tls_callback")
+#endif
+
+#pragma const_seg(".CRT$XLW")
+const PIMAGE_TLS_CALLBACK _wlibc_threads_tls_callback = threads_tls_callback;
+#pragma const_seg()
@@ -6,20 +6,39 @@
 */
 
 #include <internal/misc.h>
+#include <internal/convert.h>
 
 char *wc_to_mb(const wchar_t *wstr)
 {
-	size_t length = wcslen(wstr) + 1;
-	char *str = (char *)malloc(sizeof(char) * length);
-	wcstombs(str, wstr, length);
+	size_t length = wcslen(wstr);
+	size_t size = utf16_to_utf8((const uint16_t *)wstr, length, NULL, 0, NULL);
+	char *str = (char *)malloc(sizeof(char) * (size + 1));
+
+	if (str == NULL)
+	{
+		return NULL;
+	}
+
+	size = utf16_to_utf8((const uint16_t *)wstr, length, (uint8_t *)str, size, NULL);
+	str[size] = '\0';
+
 	return str;
 }
 
 wchar_t *mb_to_wc(const char *str)
 {
-	size_t length = strlen(str) + 1;
-	wchar_t *wstr = (wchar_t *)malloc(sizeof(wchar_t) * length);
-	mbstowcs(wstr, str, length);
+	size_t length = strlen(str);
+	size_t size = utf8_to_utf16((const uint8_t *)str, length, NULL, 0, NULL);
+	wchar_t *wstr = (wchar_t *)malloc(sizeof(wchar_t) * (size + 1));
+
+	if (wstr == NULL)
+	{
+		return NULL;
+	}
+
+	size = utf8_to_utf16((const uint8_t *)str, length, (uint16_t *)wstr, size, NULL);
+	wstr[size] = L'\0';
+
 	return wstr;
 }
 
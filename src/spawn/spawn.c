@@ -36,6 +36,8 @@ typedef struct _inherit_information
 
 static int initialize_inherit_information(inherit_information *info, int max_fd)
 {
+	BOOLEAN locked;
+
 	info->fdinfo = (inherit_fdinfo *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(inherit_fdinfo) * (max_fd + 1));
 	if (info->fdinfo == NULL)
 	{
@@ -45,13 +47,14 @@ static int initialize_inherit_information(inherit_information *info, int max_fd)
 
 	info->fds = max_fd;
 
-	SHARED_LOCK_FD_TABLE();
+	SHARED_LOCK_FD_TABLE(&locked);
 	for (int i = 0; i <= max_fd; ++i)
 	{
-		if (i < (int)_wlibc_fd_table_size)
+		// Blocks of the fd table are allocated on their first use.
+		if (i < (int)_wlibc_fd_table_size && _wlibc_fd_table[i >> FD_BLOCK_SHIFT] != NULL)
 		{
 			// The 2 structures have same alignment. Thus can be memcpy'd.
-			memcpy(&(info->fdinfo[i]), &_wlibc_fd_table[i], sizeof(inherit_fdinfo));
+			memcpy(&(info->fdinfo[i]), FD_ENTRY(i), sizeof(inherit_fdinfo));
 		}
 		else
 		{
@@ -60,7 +63,7 @@ static int initialize_inherit_information(inherit_information *info, int max_fd)
 			info->fdinfo[i].flags = 0;
 		}
 	}
-	SHARED_UNLOCK_FD_TABLE();
+	SHARED_UNLOCK_FD_TABLE(locked);
 
 	return 0;
 }
@@ -21,9 +21,11 @@ void wlibc_clearerr_unlocked(FILE *stream)
 
 void wlibc_clearerr(FILE *stream)
 {
+	BOOLEAN locked;
+
 	VALIDATE_FILE_STREAM(stream, );
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	common_clearerr(stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 }
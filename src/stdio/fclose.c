@@ -19,6 +19,8 @@ int common_fclose(FILE *stream)
 	int fd = stream->fd;
 
 	common_fflush(stream);
+	readahead_free(stream);
+	unmap_stream(stream);
 
 	if ((stream->buf_mode & _IOBUFFER_INTERNAL) && (stream->buf_mode & _IOBUFFER_ALLOCATED))
 	{
@@ -28,6 +30,11 @@ int common_fclose(FILE *stream)
 	// stream is freed here
 	delete_stream(stream);
 
+	if (fd == FD_MEMSTREAM)
+	{
+		return 0;
+	}
+
 	return wlibc_close(fd);
 }
 
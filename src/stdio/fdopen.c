@@ -45,6 +45,6 @@ FILE *wlibc_fdopen(int fd, const char *mode)
 		}
 	}
 
-	FILE *stream = create_stream(fd, _IOBUFFER_INTERNAL | _IOFBF | get_buf_mode(fd_flags), 512);
+	FILE *stream = create_stream(fd, _IOBUFFER_INTERNAL | _IOFBF | get_buf_mode(fd_flags), (int)stream_buffer_size(fd));
 	return stream;
 }
@@ -21,11 +21,13 @@ int wlibc_feof_unlocked(FILE *stream)
 
 int wlibc_feof(FILE *stream)
 {
+	BOOLEAN locked;
+
 	VALIDATE_FILE_STREAM(stream, 0);
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	int error = common_feof(stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return error;
 }
@@ -21,11 +21,13 @@ int wlibc_ferror_unlocked(FILE *stream)
 
 int wlibc_ferror(FILE *stream)
 {
+	BOOLEAN locked;
+
 	VALIDATE_FILE_STREAM(stream, 0);
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	int error = common_ferror(stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return error;
 }
@@ -13,6 +13,11 @@
 
 int common_fflush(FILE *stream)
 {
+	if (IS_MEMORY_STREAM(stream))
+	{
+		return memstream_flush(stream);
+	}
+
 	if (stream->buf_mode & _IONBF)
 	{
 		// unbuffered stream, nothing to flush
@@ -52,22 +57,27 @@ int common_flushall(int lock)
 {
 	FILE *start = _wlibc_stdio_head;
 	int status = 0;
+	BOOLEAN locked;
 
-	LOCK_STDIO();
+	// The registry only grows, no global lock is needed to walk it.
 	while (start != NULL)
 	{
+		// Skip free streams.
 		if (lock)
 		{
-			LOCK_FILE_STREAM(start);
+			LOCK_FILE_STREAM(start, &locked);
+			if (start->magic == FILE_STREAM_MAGIC)
+			{
+				status |= common_fflush(start);
+			}
+			UNLOCK_FILE_STREAM(start, locked);
 		}
-		status |= common_fflush(start);
-		if (lock)
+		else if (start->magic == FILE_STREAM_MAGIC)
 		{
-			UNLOCK_FILE_STREAM(start);
+			status |= common_fflush(start);
 		}
-		start = start->prev;
+		start = start->next;
 	}
-	UNLOCK_STDIO();
 
 	return status;
 }
@@ -85,14 +95,16 @@ int wlibc_fflush_unlocked(FILE *stream)
 
 int wlibc_fflush(FILE *stream)
 {
+	BOOLEAN locked;
+
 	if (stream == NULL)
 	{
 		return common_flushall(1);
 	}
 
 	VALIDATE_FILE_STREAM(stream, EOF);
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	int status = common_fflush(stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 	return status;
 }
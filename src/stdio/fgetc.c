@@ -37,9 +37,11 @@ int wlibc_fgetc_unlocked(FILE *stream)
 
 int wlibc_fgetc(FILE *stream)
 {
+	BOOLEAN locked;
+
 	VALIDATE_FILE_STREAM(stream, EOF);
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	int ch = common_fgetc(stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 	return ch;
 }
@@ -5,28 +5,66 @@
    Refer to the LICENSE file at the root directory for details.
 */
 
+#include <internal/minmax.h>
 #include <internal/stdio.h>
 #include <stdio.h>
 #include <string.h>
 
-int common_fgetc(FILE *stream);
+size_t common_fread(void *restrict buffer, size_t size, size_t count, FILE *restrict stream);
 
 char *common_fgets(char *restrict buffer, size_t count, FILE *restrict stream)
 {
 	char ch = 0;
 	size_t read_count = 0;
 
-	while (ch != '\n' && read_count + 1 < count)
+	while (read_count + 1 < count)
 	{
-		ch = (char)common_fgetc(stream);
-		if (ch == EOF)
+		// Search the buffered data for the newline and copy it at once.
+		if (((stream->buf_mode & _IONBF) == 0) && stream->prev_op == OP_READ && stream->pos < stream->end)
+		{
+			char *start = stream->buffer + (stream->pos - stream->start);
+			size_t length = MIN(stream->end - stream->pos, count - read_count - 1);
+			char *found = memchr(start, '\n', length);
+
+			if (found != NULL)
+			{
+				length = found - start + 1;
+			}
+
+			memcpy(buffer + read_count, start, length);
+			stream->pos += length;
+			read_count += length;
+
+			if (found != NULL)
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		// The buffer is exhausted, read the next byte. This also refills the buffer.
+		if (common_fread(&ch, 1, 1, stream) != 1)
 		{
 			break;
 		}
+
 		buffer[read_count++] = ch;
+
+		if (ch == '\n')
+		{
+			break;
+		}
 	}
 
 	buffer[read_count] = '\0';
+
+	// Nothing was read.
+	if (read_count == 0)
+	{
+		return NULL;
+	}
+
 	return buffer;
 }
 
@@ -50,6 +88,8 @@ char *wlibc_fgets_unlocked(char *restrict buffer, size_t count, FILE *restrict s
 
 char *wlibc_fgets(char *restrict buffer, size_t count, FILE *restrict stream)
 {
+	BOOLEAN locked;
+
 	if (buffer == NULL || count < 1)
 	{
 		errno = EINVAL;
@@ -63,8 +103,8 @@ char *wlibc_fgets(char *restrict buffer, size_t count, FILE *restrict stream)
 	}
 
 	VALIDATE_FILE_STREAM(stream, NULL);
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	char *buf = common_fgets(buffer, count, stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 	return buf;
 }
@@ -6,10 +6,20 @@
 */
 
 #include <internal/stdio.h>
+#include <errno.h>
 #include <stdio.h>
 
 int common_fileno(FILE *stream)
 {
+	if (stream->fd == FD_MEMSTREAM)
+	{
+		errno = EBADF;
+		return -1;
+	}
+
+	// The caller may use the fd directly.
+	readahead_stop(stream);
+
 	return stream->fd;
 }
 
@@ -21,11 +31,13 @@ int wlibc_fileno_unlocked(FILE *stream)
 
 int wlibc_fileno(FILE *stream)
 {
+	BOOLEAN locked;
+
 	VALIDATE_FILE_STREAM(stream, -1);
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	int fd = common_fileno(stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return fd;
 }
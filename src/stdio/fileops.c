@@ -13,6 +13,22 @@
 
 int common_fileno(FILE *stream);
 
+static int get_stream_flags(FILE *stream)
+{
+	// Memory streams do not have a descriptor.
+	if (stream->fd == FD_MEMSTREAM)
+	{
+		if (stream->buf_mode & _IOBUFFER_RDWR)
+		{
+			return O_RDWR;
+		}
+
+		return (stream->buf_mode & _IOBUFFER_WRONLY) ? O_WRONLY : O_RDONLY;
+	}
+
+	return get_fd_flags(common_fileno(stream));
+}
+
 // Buffer queries
 size_t wlibc_fbufsize(FILE *stream)
 {
@@ -33,11 +49,41 @@ const char *wlibc_freadptr(FILE *stream, size_t *bufsize)
 	return stream->buffer;
 }
 
+const char *wlibc_fbufptr(FILE *stream, size_t *size)
+{
+	VALIDATE_FILE_STREAM(stream, NULL);
+
+	*size = 0;
+
+	if (stream->buf_mode & _IOBUFFER_WRONLY)
+	{
+		return NULL;
+	}
+
+	if (IS_MEMORY_STREAM(stream))
+	{
+		// Everything after the position is readable in place, for mapped streams this is the rest of the file.
+		memstream_begin(stream, OP_READ);
+	}
+	else if (stream->prev_op != OP_READ)
+	{
+		return NULL;
+	}
+
+	if (stream->pos >= stream->end)
+	{
+		return NULL;
+	}
+
+	*size = stream->end - stream->pos;
+	return stream->buffer + (stream->pos - stream->start);
+}
+
 // Mode query
 int wlibc_freading(FILE *stream)
 {
 	VALIDATE_FILE_STREAM(stream, -1);
-	int flags = get_fd_flags(common_fileno(stream));
+	int flags = get_stream_flags(stream);
 
 	if (stream->prev_op == OP_READ || ((flags & (O_WRONLY | O_RDWR | O_APPEND)) == 0))
 	{
@@ -49,7 +95,7 @@ int wlibc_freading(FILE *stream)
 int wlibc_fwriting(FILE *stream)
 {
 	VALIDATE_FILE_STREAM(stream, -1);
-	int flags = get_fd_flags(common_fileno(stream));
+	int flags = get_stream_flags(stream);
 
 	if (stream->prev_op == OP_WRITE || (flags & (O_WRONLY | O_APPEND)))
 	{
@@ -61,7 +107,7 @@ int wlibc_fwriting(FILE *stream)
 int wlibc_freadable(FILE *stream)
 {
 	VALIDATE_FILE_STREAM(stream, -1);
-	int flags = get_fd_flags(common_fileno(stream));
+	int flags = get_stream_flags(stream);
 
 	if ((flags & O_WRONLY) == 0 || flags & O_RDWR)
 	{
@@ -73,7 +119,7 @@ int wlibc_freadable(FILE *stream)
 int wlibc_fwritable(FILE *stream)
 {
 	VALIDATE_FILE_STREAM(stream, -1);
-	int flags = get_fd_flags(common_fileno(stream));
+	int flags = get_stream_flags(stream);
 
 	if ((flags & (O_WRONLY | O_RDWR | O_APPEND)) != 0)
 	{
@@ -109,7 +155,8 @@ void wlibc_fpurge(FILE *stream)
 {
 	VALIDATE_FILE_STREAM(stream, );
 
-	if (stream->buf_mode != _IONBF)
+	// Memory streams are written in place, nothing to discard.
+	if (stream->buf_mode != _IONBF && !IS_MEMORY_STREAM(stream))
 	{
 		if (stream->prev_op == OP_WRITE)
 		{
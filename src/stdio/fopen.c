@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 
 int do_open(int dirfd, const char *name, int oflags, mode_t perm);
 
@@ -23,6 +24,7 @@ FILE *wlibc_fopen(const char *restrict name, const char *restrict mode)
 		return NULL;
 	}
 
+	FILE *stream = NULL;
 	int flags = parse_mode(mode);
 	int fd = do_open(AT_FDCWD, name, flags | O_NOTDIR, 0700);
 
@@ -31,6 +33,25 @@ FILE *wlibc_fopen(const char *restrict name, const char *restrict mode)
 		return NULL;
 	}
 
-	FILE *stream = create_stream(fd, _IOBUFFER_INTERNAL | _IOFBF | get_buf_mode(flags), 512);
+	// Read only files can be mapped whole ('m'), reads are then done in place.
+	if (strchr(mode, 'm') != NULL && (flags & (O_WRONLY | O_RDWR)) == 0 && get_fd_type(fd) == FILE_HANDLE)
+	{
+		stream = map_stream(fd);
+
+		if (stream != NULL)
+		{
+			return stream;
+		}
+	}
+
+	int buf_mode = _IOBUFFER_INTERNAL | _IOFBF | get_buf_mode(flags);
+
+	// Read the next block in the background for read only files opened for sequential access ('S').
+	if ((flags & O_SEQUENTIAL) && (buf_mode & _IOBUFFER_RDONLY) && get_fd_type(fd) == FILE_HANDLE)
+	{
+		buf_mode |= _IOBUFFER_READAHEAD;
+	}
+
+	stream = create_stream(fd, buf_mode, (int)stream_buffer_size(fd));
 	return stream;
 }
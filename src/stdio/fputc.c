@@ -37,9 +37,11 @@ int wlibc_fputc_unlocked(int ch, FILE *stream)
 
 int wlibc_fputc(int ch, FILE *stream)
 {
+	BOOLEAN locked;
+
 	VALIDATE_FILE_STREAM(stream, EOF);
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	int result = common_fputc(ch, stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 	return result;
 }
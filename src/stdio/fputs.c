@@ -33,6 +33,8 @@ int wlibc_fputs_unlocked(const char *restrict buffer, FILE *restrict stream)
 
 int wlibc_fputs(const char *restrict buffer, FILE *restrict stream)
 {
+	BOOLEAN locked;
+
 	if (buffer == NULL)
 	{
 		errno = EINVAL;
@@ -41,9 +43,9 @@ int wlibc_fputs(const char *restrict buffer, FILE *restrict stream)
 
 	VALIDATE_FILE_STREAM(stream, EOF);
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	int result = common_fputs(buffer, stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return result;
 }
@@ -13,7 +13,17 @@ int common_fflush(FILE *stream);
 
 static ssize_t read_wrapper(FILE *restrict stream, void *restrict buffer, size_t size)
 {
-	ssize_t result = read(stream->fd, buffer, size);
+	ssize_t result = 0;
+
+	if (stream->buf_mode & _IOBUFFER_READAHEAD)
+	{
+		result = readahead_read(stream, buffer, size);
+	}
+	else
+	{
+		result = read(stream->fd, buffer, size);
+	}
+
 	// Set the stream error states
 	if (result == 0)
 	{
@@ -45,11 +55,34 @@ size_t common_fread(void *restrict buffer, size_t size, size_t count, FILE *rest
 		return 0;
 	}
 
+	// Memory streams are read in place.
+	if (IS_MEMORY_STREAM(stream))
+	{
+		return memstream_read(buffer, size * count, stream) / size;
+	}
+
 	// unbuffered read stream
 	if ((stream->buf_mode & _IONBF))
 	{
+		size_t data_size = size * count;
+		size_t unread = 0;
+
+		// Lookahead given back by scanf comes first.
+		if (stream->unread_count != 0)
+		{
+			unread = stream->unread_count < data_size ? stream->unread_count : data_size;
 
-		result = read_wrapper(stream, buffer, size * count);
+			memcpy(buffer, stream->unread, unread);
+			memmove(stream->unread, stream->unread + unread, stream->unread_count - unread);
+			stream->unread_count -= unread;
+		}
+
+		if (unread < data_size)
+		{
+			result = read_wrapper(stream, (char *)buffer + unread, data_size - unread);
+		}
+
+		result += unread;
 		stream->prev_op = OP_READ;
 
 		if (result != 0)
@@ -96,6 +129,7 @@ size_t common_fread(void *restrict buffer, size_t size, size_t count, FILE *rest
 
 			// copy already read data first
 			size_t bytes_read = 0;
+			size_t window = stream->end - stream->start;
 			ssize_t read_result = 1;
 			if (stream->pos < stream->end)
 			{
@@ -122,6 +156,10 @@ size_t common_fread(void *restrict buffer, size_t size, size_t count, FILE *rest
 			if (read_result > 0)
 			{
 				size_t last_read_count = 0;
+
+				// The buffer is empty here, resize it if required.
+				adapt_stream_buffer(stream, window);
+
 				while (last_read_count < stream->buf_size && last_read_count < (data_size - bytes_read))
 				{
 					// read the last block into the stream buffer
@@ -169,6 +207,8 @@ size_t wlibc_fread_unlocked(void *restrict buffer, size_t size, size_t count, FI
 
 size_t wlibc_fread(void *restrict buffer, size_t size, size_t count, FILE *restrict stream)
 {
+	BOOLEAN locked;
+
 	if (buffer == NULL)
 	{
 		errno = EINVAL;
@@ -182,9 +222,9 @@ size_t wlibc_fread(void *restrict buffer, size_t size, size_t count, FILE *restr
 
 	VALIDATE_FILE_STREAM(stream, 0);
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	size_t ret = common_fread(buffer, size, count, stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return ret;
 }
@@ -21,11 +21,26 @@ FILE *wlibc_freopen(const char *restrict name, const char *restrict mode, FILE *
 {
 	VALIDATE_FILE_STREAM(stream, NULL);
 
+	// Memory streams have no file to reopen.
+	if (stream->fd == FD_MEMSTREAM)
+	{
+		errno = EBADF;
+		return NULL;
+	}
+
 	int new_fd;
 	int flags = parse_mode(mode);
 
 	// Flush the stream first
 	common_fflush(stream);
+	readahead_free(stream);
+
+	// The new file is read through an ordinary buffer.
+	if (stream->buf_mode & _IOBUFFER_MAPPED)
+	{
+		unmap_stream(stream);
+		stream->buf_mode |= _IOBUFFER_INTERNAL;
+	}
 
 	if (name == NULL)
 	{
@@ -76,9 +91,15 @@ FILE *wlibc_freopen(const char *restrict name, const char *restrict mode, FILE *
 	stream->pos = 0;
 	stream->prev_op = 0;
 	// Remove these buffer bits as we are setting them below based on mode
-	stream->buf_mode = stream->buf_mode & ~(_IOBUFFER_RDONLY | _IOBUFFER_WRONLY | _IOBUFFER_RDWR);
+	stream->buf_mode = stream->buf_mode & ~(_IOBUFFER_RDONLY | _IOBUFFER_WRONLY | _IOBUFFER_RDWR | _IOBUFFER_READAHEAD);
 	stream->buf_mode |= get_buf_mode(flags);
 
+	if (stream->buf_size == 0 && (stream->buf_mode & _IOBUFFER_INTERNAL))
+	{
+		stream->buf_size = stream_buffer_size(new_fd);
+		stream->base_size = stream->buf_size;
+	}
+
 	return stream;
 
 reopen_same_file_fail:
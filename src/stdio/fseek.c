@@ -14,6 +14,11 @@ int common_fflush(FILE *stream);
 
 int common_fseek(FILE *stream, ssize_t offset, int whence)
 {
+	if (IS_MEMORY_STREAM(stream))
+	{
+		return memstream_seek(stream, offset, whence);
+	}
+
 	// If the stream was written to previously flush
 	if (stream->prev_op == OP_WRITE)
 	{
@@ -31,6 +36,9 @@ int common_fseek(FILE *stream, ssize_t offset, int whence)
 		}
 	}
 
+	// Fall back to plain reads, the access is no longer sequential.
+	readahead_stop(stream);
+
 	off_t result = lseek(stream->fd, offset, whence);
 
 	if (result != -1)
@@ -38,6 +46,7 @@ int common_fseek(FILE *stream, ssize_t offset, int whence)
 		stream->pos = result;
 		stream->start = stream->pos;
 		stream->end = stream->pos;
+		stream->unread_count = 0;
 
 		if (whence == SEEK_SET && offset == 0)
 		{
@@ -58,6 +67,8 @@ int common_fseek(FILE *stream, ssize_t offset, int whence)
 
 int wlibc_fseek(FILE *stream, ssize_t offset, int whence)
 {
+	BOOLEAN locked;
+
 	VALIDATE_FILE_STREAM(stream, EOF);
 	if (whence < 0 || whence > 2)
 	{
@@ -66,8 +77,8 @@ int wlibc_fseek(FILE *stream, ssize_t offset, int whence)
 	}
 
 	int result;
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	result = common_fseek(stream, offset, whence);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 	return result;
 }
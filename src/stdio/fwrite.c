@@ -10,6 +10,54 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/uio.h>
+
+// Prepare a buffered stream for writing into its buffer.
+int common_fwrite_begin(FILE *stream)
+{
+	if (stream->fd == FD_MEMSTREAM)
+	{
+		return memstream_begin(stream, OP_WRITE);
+	}
+
+	if (stream->prev_op != OP_WRITE) // OP_READ or 'nothing'
+	{
+		// Seek to end of file if we are 'starting' to append.
+		if (get_fd_flags(stream->fd) & O_APPEND)
+		{
+			stream->pos = lseek(stream->fd, 0, SEEK_END);
+		}
+		// If the previous operation was a read, seek to where the stream position actually is.
+		else if (stream->prev_op == OP_READ) // not appending
+		{
+			lseek(stream->fd, stream->pos, SEEK_SET);
+		}
+		stream->start = stream->pos;
+		stream->end = stream->pos;
+	}
+	stream->prev_op = OP_WRITE;
+
+	// allocate the buffer if not allocated already
+	if ((stream->buf_mode & _IOBUFFER_INTERNAL) && ((stream->buf_mode & _IOBUFFER_ALLOCATED) == 0))
+	{
+		stream->buffer = (char *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(char) * stream->buf_size);
+		if (stream->buffer == NULL)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+
+		stream->buf_mode |= _IOBUFFER_ALLOCATED;
+	}
+
+	if (stream->start == stream->end && ((stream->buf_mode & _IOBUFFER_ALLOCATED) || (stream->buf_mode & _IOBUFFER_EXTERNAL)))
+	{
+		stream->start = stream->pos;
+		stream->end = stream->pos + stream->buf_size;
+	}
+
+	return 0;
+}
 
 size_t common_fwrite(const void *restrict buffer, size_t size, size_t count, FILE *restrict stream)
 {
@@ -29,6 +77,12 @@ size_t common_fwrite(const void *restrict buffer, size_t size, size_t count, FIL
 		return 0;
 	}
 
+	// Memory streams are written in place.
+	if (stream->fd == FD_MEMSTREAM)
+	{
+		return memstream_write(buffer, size * count, stream) / size;
+	}
+
 	// unbuffered stream
 	if ((stream->buf_mode & _IONBF))
 	{
@@ -45,41 +99,9 @@ size_t common_fwrite(const void *restrict buffer, size_t size, size_t count, FIL
 	}
 	else
 	{
-
-		if (stream->prev_op != OP_WRITE) // OP_READ or 'nothing'
+		if (common_fwrite_begin(stream) == -1)
 		{
-			// Seek to end of file if we are 'starting' to append.
-			if (get_fd_flags(stream->fd) & O_APPEND)
-			{
-				stream->pos = lseek(stream->fd, 0, SEEK_END);
-			}
-			// If the previous operation was a read, seek to where the stream position actually is.
-			else if (stream->prev_op == OP_READ) // not appending
-			{
-				lseek(stream->fd, stream->pos, SEEK_SET);
-			}
-			stream->start = stream->pos;
-			stream->end = stream->pos;
-		}
-		stream->prev_op = OP_WRITE;
-
-		// allocate the buffer if not allocated already
-		if ((stream->buf_mode & _IOBUFFER_INTERNAL) && ((stream->buf_mode & _IOBUFFER_ALLOCATED) == 0))
-		{
-			stream->buffer = (char *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(char) * stream->buf_size);
-			if (stream->buffer == NULL)
-			{
-				errno = ENOMEM;
-				return 0;
-			}
-
-			stream->buf_mode |= _IOBUFFER_ALLOCATED;
-		}
-
-		if (stream->start == stream->end && ((stream->buf_mode & _IOBUFFER_ALLOCATED) || (stream->buf_mode & _IOBUFFER_EXTERNAL)))
-		{
-			stream->start = stream->pos;
-			stream->end = stream->pos + stream->buf_size;
+			return 0;
 		}
 
 		size_t data_size = size * count;
@@ -93,47 +115,50 @@ size_t common_fwrite(const void *restrict buffer, size_t size, size_t count, FIL
 
 		else // if (data_size > stream->end - stream->pos)
 		{
-			size_t bytes_written = 0;
-			ssize_t write_result = 1;
+			size_t pending = stream->pos - stream->start;
+			size_t fill = stream->end - stream->pos;
 
-			// fill out the write buffer first if not empty.
-			if (stream->end - stream->pos != stream->buf_size)
+			if (pending != 0 && data_size - fill <= stream->buf_size)
 			{
-				memcpy(stream->buffer + (stream->pos - stream->start), buffer, stream->end - stream->pos);
+				// Fill out the write buffer and flush it, the rest goes into the next buffer.
+				memcpy(stream->buffer + pending, buffer, fill);
+
 				if (write(stream->fd, stream->buffer, stream->buf_size) == -1)
 				{
 					stream->error = _IOERROR;
 					return 0;
 				}
 
-				bytes_written = stream->end - stream->pos;
+				stream->pos += fill;
+				stream->start = stream->pos;
+				stream->end = stream->pos;
+
+				// The buffer is empty here, resize it if required.
+				adapt_stream_buffer(stream, stream->buf_size);
+
+				return (fill + common_fwrite((char *)buffer + fill, 1, data_size - fill, stream)) / size;
 			}
 
-			while (bytes_written + stream->buf_size < data_size)
+			// Write what is buffered along with the payload, the payload is not copied or split up.
+			struct iovec iov[2] = {{stream->buffer, pending}, {(void *)buffer, data_size}};
+
+			result = writev(stream->fd, iov, 2);
+
+			if (result == -1 || (size_t)result < pending)
 			{
-				// Write directly from the target buffer
-				write_result = write(stream->fd, (char *)buffer + bytes_written, stream->buf_size);
-				if (write_result == -1) // ERROR
-				{
-					break;
-				}
-				bytes_written += write_result;
+				stream->error = _IOERROR;
+				return 0;
 			}
-			result = bytes_written;
-			stream->pos += bytes_written;
+
+			result -= pending;
+			stream->pos += result;
 			// writes until this point are not buffered by us
 			stream->start = stream->pos;
 			stream->end = stream->pos;
 
-			if (write_result > 0)
+			if ((size_t)result != data_size)
 			{
-				// copy the remaining bytes into the stream buffer
-				size_t remaining_copy_size = (data_size - bytes_written);
-				memcpy(stream->buffer, (char *)buffer + bytes_written, remaining_copy_size);
-				stream->end = stream->pos + stream->buf_size;
-				stream->start = stream->pos;
-				stream->pos += remaining_copy_size;
-				result += remaining_copy_size;
+				stream->error = _IOERROR;
 			}
 		}
 	}
@@ -165,6 +190,8 @@ size_t wlibc_fwrite_unlocked(const void *restrict buffer, size_t size, size_t co
 
 size_t wlibc_fwrite(const void *restrict buffer, size_t size, size_t count, FILE *restrict stream)
 {
+	BOOLEAN locked;
+
 	if (buffer == NULL)
 	{
 		errno = EINVAL;
@@ -178,9 +205,9 @@ size_t wlibc_fwrite(const void *restrict buffer, size_t size, size_t count, FILE
 
 	VALIDATE_FILE_STREAM(stream, 0);
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	size_t ret = common_fwrite(buffer, size, count, stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return ret;
 }
@@ -10,65 +10,113 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-int common_fgetc(FILE *stream);
-int common_fseek(FILE *stream, ssize_t offset, int whence);
 size_t common_fread(void *restrict buffer, size_t size, size_t count, FILE *restrict stream);
 
+static int reserve_buffer(char **restrict buffer, size_t *restrict size, size_t required)
+{
+	size_t buffer_size = *size;
+	char *temp = NULL;
+
+	if (required <= buffer_size)
+	{
+		return 0;
+	}
+
+	// Double the buffer.
+	while (buffer_size < required)
+	{
+		buffer_size *= 2;
+	}
+
+	temp = (char *)realloc(*buffer, buffer_size);
+
+	if (temp == NULL)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	*buffer = temp;
+	*size = buffer_size;
+
+	return 0;
+}
+
 ssize_t common_getdelim(char **restrict buffer, size_t *restrict size, int delimiter, FILE *restrict stream)
 {
 	char ch = 0;
 	ssize_t result = 0;
-	size_t buffer_size = *size;
 
 	if (*buffer == NULL)
 	{
 		// Allocate 512 bytes initially
-		buffer_size = 512;
-		*buffer = (char *)malloc(buffer_size);
+		*buffer = (char *)malloc(512);
 		if (*buffer == NULL)
 		{
 			errno = ENOMEM;
 			return -1;
 		}
 
-		*size = buffer_size;
+		*size = 512;
 	}
 
-	/*
-	 TODO : Improve preformance of this function.
-	 NOTE : While doing so keep in mind that this needs to work with pipes as well.
-	*/
 	while (1)
 	{
-		ch = (char)common_fgetc(stream);
-		if (ch == EOF)
+		// Search the buffered data for the delimiter and copy it at once.
+		if (((stream->buf_mode & _IONBF) == 0) && stream->prev_op == OP_READ && stream->pos < stream->end)
 		{
-			result = -1;
-			break;
-		}
+			char *start = stream->buffer + (stream->pos - stream->start);
+			size_t count = stream->end - stream->pos;
+			char *found = memchr(start, delimiter, count);
 
-		(*buffer)[result] = ch;
-		++result;
+			if (found != NULL)
+			{
+				count = found - start + 1;
+			}
 
-		if (ch == delimiter)
-		{
-			break;
+			if (reserve_buffer(buffer, size, result + count + 1) == -1)
+			{
+				return -1;
+			}
+
+			memcpy(*buffer + result, start, count);
+			stream->pos += count;
+			result += count;
+
+			if (found != NULL)
+			{
+				break;
+			}
+
+			continue;
 		}
 
-		if (result == (ssize_t)*size)
+		// The buffer is exhausted, read the next byte. This also refills the buffer.
+		// NOTE : This needs to work with pipes and unbuffered streams as well.
+		if (common_fread(&ch, 1, 1, stream) != 1)
 		{
-			// Double the buffer.
-			char *temp = (char *)realloc(*buffer, buffer_size * 2);
-			if (temp == NULL)
+			// A final line without the delimiter is still returned, the next call fails.
+			if (result == 0)
 			{
-				errno = ENOMEM;
-				return -1;
+				result = -1;
 			}
 
-			*buffer = temp;
-			buffer_size *= 2;
-			*size = buffer_size;
+			break;
+		}
+
+		if (reserve_buffer(buffer, size, result + 2) == -1)
+		{
+			return -1;
+		}
+
+		(*buffer)[result] = ch;
+		++result;
+
+		if (ch == (char)delimiter)
+		{
+			break;
 		}
 	}
 
@@ -83,6 +131,7 @@ ssize_t common_getdelim(char **restrict buffer, size_t *restrict size, int delim
 ssize_t wlibc_getdelim(char **restrict buffer, size_t *restrict size, int delimiter, FILE *restrict stream)
 {
 	ssize_t result;
+	BOOLEAN locked;
 
 	if (buffer == NULL || size == NULL || (*buffer != NULL && *size == 0))
 	{
@@ -91,9 +140,9 @@ ssize_t wlibc_getdelim(char **restrict buffer, size_t *restrict size, int delimi
 	}
 	VALIDATE_FILE_STREAM(stream, -1);
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	result = common_getdelim(buffer, size, delimiter, stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return result;
 }
@@ -8,23 +8,26 @@
 #include <internal/nt.h>
 #include <internal/fcntl.h>
 #include <internal/stdio.h>
+#include <internal/minmax.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
 
-FILE *_wlibc_stdio_head = NULL;
+FILE *volatile _wlibc_stdio_head = NULL;
 
 FILE *_wlibc_stdin = NULL;
 FILE *_wlibc_stdout = NULL;
 FILE *_wlibc_stderr = NULL;
 
-RTL_CRITICAL_SECTION _wlibc_stdio_critical;
+// Closed streams are recycled from here, their critical sections are kept initialized.
+static SLIST_HEADER _wlibc_stdio_pool;
 
 static void insert_stream(FILE *stream);
 
 void initialize_stdio(void)
 {
-	RtlInitializeCriticalSection(&_wlibc_stdio_critical);
-
-	_wlibc_stdin = create_stream(0, _IOFBF | _IOBUFFER_INTERNAL | _IOBUFFER_RDONLY, 512);
-	_wlibc_stdout = create_stream(1, _IOFBF | _IOBUFFER_INTERNAL | _IOBUFFER_WRONLY, 512);
+	_wlibc_stdin = create_stream(0, _IOFBF | _IOBUFFER_INTERNAL | _IOBUFFER_RDONLY, (int)stream_buffer_size(0));
+	_wlibc_stdout = create_stream(1, _IOFBF | _IOBUFFER_INTERNAL | _IOBUFFER_WRONLY, (int)stream_buffer_size(1));
 	_wlibc_stderr = create_stream(2, _IONBF | _IOBUFFER_WRONLY, 0);
 }
 
@@ -32,115 +35,230 @@ int common_fflush(FILE *stream);
 
 void close_all_streams(void)
 {
-	LOCK_STDIO();
-
-	FILE *head = _wlibc_stdio_head;
+	FILE *stream = NULL;
+	BOOLEAN locked;
 
 	// Flush all streams first.
-	while (_wlibc_stdio_head != NULL)
+	for (stream = _wlibc_stdio_head; stream != NULL; stream = stream->next)
 	{
-		FILE *prev = _wlibc_stdio_head->prev;
+		LOCK_FILE_STREAM(stream, &locked);
 
-		// Flush buffered data.
-		common_fflush(_wlibc_stdio_head);
-
-		// Free internal buffers if any.
-		if (_wlibc_stdio_head->buffer != NULL && (_wlibc_stdio_head->buf_mode & _IOBUFFER_INTERNAL))
+		if (stream->magic == FILE_STREAM_MAGIC)
 		{
-			RtlFreeHeap(NtCurrentProcessHeap(), 0, _wlibc_stdio_head->buffer);
+			// Flush buffered data.
+			common_fflush(stream);
+			readahead_free(stream);
+			unmap_stream(stream);
+
+			// Free internal buffers if any.
+			if (stream->buffer != NULL && (stream->buf_mode & _IOBUFFER_INTERNAL))
+			{
+				RtlFreeHeap(NtCurrentProcessHeap(), 0, stream->buffer);
+				stream->buffer = NULL;
+			}
 		}
-		RtlDeleteCriticalSection(&(_wlibc_stdio_head->critical));
 
-		_wlibc_stdio_head = prev;
+		UNLOCK_FILE_STREAM(stream, locked);
 	}
 
-	_wlibc_stdio_head = head;
-
 	// Then close all associated file descriptors.
-	while (_wlibc_stdio_head != NULL)
+	for (stream = _wlibc_stdio_head; stream != NULL; stream = stream->next)
 	{
-		FILE *prev = _wlibc_stdio_head->prev;
+		LOCK_FILE_STREAM(stream, &locked);
 
-		close_fd(_wlibc_stdio_head->fd);
-		RtlFreeHeap(NtCurrentProcessHeap(), 0, _wlibc_stdio_head);
+		if (stream->magic == FILE_STREAM_MAGIC)
+		{
+			if (stream->fd != FD_MEMSTREAM)
+			{
+				close_fd(stream->fd);
+			}
 
-		_wlibc_stdio_head = prev;
-	}
+			delete_stream(stream);
+		}
 
-	UNLOCK_STDIO();
+		UNLOCK_FILE_STREAM(stream, locked);
+	}
 }
 
 void cleanup_stdio(void)
 {
+	FILE *stream = _wlibc_stdio_head;
+
 	close_all_streams();
-	RtlDeleteCriticalSection(&_wlibc_stdio_critical);
+
+	// Only now can the streams be freed.
+	while (stream != NULL)
+	{
+		FILE *next = stream->next;
+
+		RtlDeleteCriticalSection(&(stream->critical));
+		RtlFreeHeap(NtCurrentProcessHeap(), 0, stream);
+
+		stream = next;
+	}
+
+	_wlibc_stdio_head = NULL;
+	RtlInitializeSListHead(&_wlibc_stdio_pool);
 }
 
 FILE *create_stream(int fd, int buf_mode, int buf_size)
 {
-	FILE *stream = (FILE *)RtlAllocateHeap(NtCurrentProcessHeap(), HEAP_ZERO_MEMORY, sizeof(FILE));
+	FILE *stream = NULL;
+	PSLIST_ENTRY entry = RtlInterlockedPopEntrySList(&_wlibc_stdio_pool);
+	BOOLEAN locked;
 
-	if (stream == NULL)
+	if (entry != NULL)
 	{
-		errno = ENOMEM;
-		return NULL;
+		stream = CONTAINING_RECORD(entry, FILE, pool);
 	}
+	else
+	{
+		stream = (FILE *)RtlAllocateHeap(NtCurrentProcessHeap(), HEAP_ZERO_MEMORY, sizeof(FILE));
+
+		if (stream == NULL)
+		{
+			errno = ENOMEM;
+			return NULL;
+		}
+
+		RtlInitializeCriticalSection(&(stream->critical));
+		insert_stream(stream);
+	}
+
+	// A recycled stream might be visited by fflush(NULL), initialize it under its lock.
+	LOCK_FILE_STREAM(stream, &locked);
+
+	memset(stream, 0, offsetof(FILE, critical));
 
-	stream->magic = FILE_STREAM_MAGIC;
 	stream->fd = fd;
 	stream->buf_mode = buf_mode;
 	stream->buf_size = buf_size;
+	stream->base_size = buf_size;
+	stream->magic = FILE_STREAM_MAGIC;
 
-	RtlInitializeCriticalSection(&(stream->critical));
-	insert_stream(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return stream;
 }
 
-void insert_stream(FILE *stream)
+static void insert_stream(FILE *stream)
 {
+	FILE *head = NULL;
+
 	// stream won't be null here.
-	LOCK_STDIO();
+	do
+	{
+		head = _wlibc_stdio_head;
+		stream->next = head;
+	} while (_InterlockedCompareExchangePointer((PVOID volatile *)&_wlibc_stdio_head, stream, head) != head);
+}
 
-	stream->prev = _wlibc_stdio_head;
-	stream->next = NULL;
+void delete_stream(FILE *stream)
+{
+	BOOLEAN locked;
 
-	if (_wlibc_stdio_head != NULL)
+	// stream won't be null here.
+	LOCK_FILE_STREAM(stream, &locked);
+	stream->magic = 0;
+	UNLOCK_FILE_STREAM(stream, locked);
+
+	// The stream stays in the registry, it is only returned to the pool.
+	RtlInterlockedPushEntrySList(&_wlibc_stdio_pool, &(stream->pool));
+}
+
+#define STDIO_CONSOLE_BUFFER_SIZE 512
+#define STDIO_PIPE_BUFFER_SIZE    4096
+#define STDIO_FILE_BUFFER_SIZE    65536
+#define STDIO_MAX_BUFFER_SIZE     1048576
+
+#define STDIO_BUFFER_GROW_THRESHOLD 4    // consecutive full transfers
+#define STDIO_BUFFER_IDLE_TIME      1000 // milliseconds
+
+size_t stream_buffer_size(int fd)
+{
+	NTSTATUS status;
+	IO_STATUS_BLOCK io;
+	FILE_PIPE_LOCAL_INFORMATION pipe_info;
+	size_t quota = 0;
+
+	switch (get_fd_type(fd))
 	{
-		_wlibc_stdio_head->next = stream;
-	}
+	case FILE_HANDLE:
+		return STDIO_FILE_BUFFER_SIZE;
+	case PIPE_HANDLE:
+	{
+		// Match the pipe's buffer, so that each write fills it at most once.
+		status = NtQueryInformationFile(get_fd_handle(fd), &io, &pipe_info, sizeof(FILE_PIPE_LOCAL_INFORMATION), FilePipeLocalInformation);
+
+		if (status != STATUS_SUCCESS)
+		{
+			return STDIO_PIPE_BUFFER_SIZE;
+		}
 
-	_wlibc_stdio_head = stream;
+		quota = MAX(pipe_info.InboundQuota, pipe_info.OutboundQuota);
+		quota = (quota + (STDIO_PIPE_BUFFER_SIZE - 1)) & ~(size_t)(STDIO_PIPE_BUFFER_SIZE - 1);
 
-	UNLOCK_STDIO();
+		return MIN(MAX(quota, STDIO_PIPE_BUFFER_SIZE), STDIO_FILE_BUFFER_SIZE);
+	}
+	default:
+		// Consoles are interactive, keep the buffer small.
+		return STDIO_CONSOLE_BUFFER_SIZE;
+	}
 }
 
-void delete_stream(FILE *stream)
+// Called when the stream buffer is empty, after transferring 'transferred' bytes through it.
+void adapt_stream_buffer(FILE *stream, size_t transferred)
 {
-	// stream won't be null here.
-	LOCK_STDIO();
+	ULONGLONG now = GetTickCount64();
+	size_t size = stream->buf_size;
 
-	if (stream->prev != NULL && stream->next != NULL)
+	// Only internal buffers of streams we sized ourselves.
+	if ((stream->buf_mode & _IOBUFFER_INTERNAL) == 0 || stream->base_size == 0)
 	{
-		stream->prev->next = stream->next;
-		stream->next->prev = stream->prev;
+		return;
 	}
-	else if (stream->prev != NULL && stream->next == NULL)
+
+	if (stream->last_transfer != 0 && (now - stream->last_transfer) > STDIO_BUFFER_IDLE_TIME)
 	{
-		stream->prev->next = NULL;
-		_wlibc_stdio_head = stream->prev;
+		// Shrink back after being idle.
+		size = stream->base_size;
+		stream->full_transfers = 0;
 	}
-	else if (stream->prev == NULL && stream->next != NULL)
+	else if (transferred == stream->buf_size)
 	{
-		stream->next->prev = NULL;
+		stream->full_transfers += 1;
+
+		if (stream->full_transfers == STDIO_BUFFER_GROW_THRESHOLD)
+		{
+			size = MIN(stream->buf_size * 2, STDIO_MAX_BUFFER_SIZE);
+			stream->full_transfers = 0;
+		}
 	}
-	else // if(stream->prev == NULL && stream->next == NULL)
+	else
 	{
-		_wlibc_stdio_head = NULL;
+		stream->full_transfers = 0;
 	}
 
-	RtlDeleteCriticalSection(&(stream->critical));
-	RtlFreeHeap(NtCurrentProcessHeap(), 0, stream);
+	stream->last_transfer = now;
+
+	if (size == stream->buf_size)
+	{
+		return;
+	}
+
+	if (stream->buf_mode & _IOBUFFER_ALLOCATED)
+	{
+		// The contents need not be preserved.
+		char *buffer = (char *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, size);
+
+		if (buffer == NULL)
+		{
+			return;
+		}
+
+		RtlFreeHeap(NtCurrentProcessHeap(), 0, stream->buffer);
+		stream->buffer = buffer;
+	}
 
-	UNLOCK_STDIO();
+	stream->buf_size = size;
 }
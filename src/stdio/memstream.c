@@ -0,0 +1,389 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#include <internal/nt.h>
+#include <internal/stdio.h>
+#include <internal/minmax.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MEMSTREAM_CHUNK_SIZE 4096
+
+// Account for the bytes written in place (printf, fputc) since the last operation.
+static void memstream_sync(FILE *stream)
+{
+	if (stream->prev_op == OP_WRITE && stream->pos > stream->length)
+	{
+		stream->length = stream->pos;
+
+		// Keep the contents terminated if there is room, open_memstream always has room.
+		if (stream->length < stream->buf_size || stream->memptr != NULL)
+		{
+			stream->buffer[stream->length] = '\0';
+		}
+	}
+}
+
+static int memstream_grow(FILE *stream, size_t size)
+{
+	size_t capacity = stream->buf_size;
+	char *buffer = NULL;
+
+	if (size <= stream->buf_size)
+	{
+		return 0;
+	}
+
+	// fmemopen streams are bounded by the given buffer.
+	if (stream->memptr == NULL)
+	{
+		return -1;
+	}
+
+	while (capacity < size)
+	{
+		capacity *= 2;
+	}
+
+	// *ptr is freed by the caller, use the CRT allocator. Allocate one more for the terminator.
+	buffer = (char *)realloc(stream->buffer, capacity + 1);
+
+	if (buffer == NULL)
+	{
+		errno = ENOMEM;
+		stream->error = _IOERROR;
+		return -1;
+	}
+
+	// The unused portion is always zero, so seeking past the end leaves a gap of zeros.
+	memset(buffer + stream->buf_size + 1, 0, capacity - stream->buf_size);
+
+	stream->buffer = buffer;
+	stream->buf_size = capacity;
+
+	if (stream->prev_op == OP_WRITE)
+	{
+		stream->end = stream->buf_size;
+	}
+
+	return 0;
+}
+
+int memstream_begin(FILE *stream, int op)
+{
+	memstream_sync(stream);
+
+	stream->start = 0;
+
+	if (op == OP_READ)
+	{
+		// Nothing can be read past the contents.
+		stream->end = (stream->pos <= stream->length) ? stream->length : 0;
+	}
+	else
+	{
+		if (stream->buf_mode & _IOBUFFER_APPEND)
+		{
+			stream->pos = stream->length;
+		}
+
+		stream->end = stream->buf_size;
+	}
+
+	stream->prev_op = op;
+
+	return 0;
+}
+
+size_t memstream_reserve(FILE *stream, size_t size)
+{
+	if (memstream_grow(stream, stream->pos + size) == -1)
+	{
+		if (stream->memptr == NULL)
+		{
+			errno = ENOSPC;
+		}
+
+		stream->error = _IOERROR;
+	}
+
+	return stream->buf_size - MIN(stream->pos, stream->buf_size);
+}
+
+size_t memstream_read(void *buffer, size_t size, FILE *stream)
+{
+	size_t count = 0;
+
+	memstream_begin(stream, OP_READ);
+
+	if (stream->pos < stream->length)
+	{
+		count = MIN(size, stream->length - stream->pos);
+		memcpy(buffer, stream->buffer + stream->pos, count);
+		stream->pos += count;
+	}
+
+	if (count < size)
+	{
+		stream->error = _IOEOF;
+	}
+
+	return count;
+}
+
+size_t memstream_write(const void *buffer, size_t size, FILE *stream)
+{
+	size_t count = 0;
+
+	memstream_begin(stream, OP_WRITE);
+
+	// Write what fits.
+	count = MIN(size, memstream_reserve(stream, size));
+
+	memcpy(stream->buffer + stream->pos, buffer, count);
+	stream->pos += count;
+
+	return count;
+}
+
+int memstream_seek(FILE *stream, ssize_t offset, int whence)
+{
+	ssize_t position = 0;
+
+	memstream_sync(stream);
+
+	switch (whence)
+	{
+	case SEEK_SET:
+		position = offset;
+		break;
+	case SEEK_CUR:
+		position = stream->pos + offset;
+		break;
+	case SEEK_END:
+		position = stream->length + offset;
+		break;
+	}
+
+	if (position < 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Mapped streams can be positioned past the end like files, reads there give EOF.
+	if ((stream->buf_mode & _IOBUFFER_MAPPED) == 0 && memstream_grow(stream, position) == -1)
+	{
+		if (stream->memptr == NULL)
+		{
+			// Cannot seek past the given buffer.
+			errno = EINVAL;
+		}
+
+		return -1;
+	}
+
+	stream->pos = position;
+	stream->start = 0;
+	stream->end = 0;
+	stream->prev_op = 0;
+
+	if (whence == SEEK_SET && offset == 0)
+	{
+		// Clear any error
+		stream->error = 0;
+	}
+	else
+	{
+		// Clear eof only
+		stream->error = stream->error & ~_IOEOF;
+	}
+
+	return 0;
+}
+
+int memstream_flush(FILE *stream)
+{
+	memstream_sync(stream);
+
+	if (stream->memptr != NULL)
+	{
+		*stream->memptr = stream->buffer;
+		*stream->memsize = MIN(stream->length, stream->pos);
+	}
+
+	return 0;
+}
+
+FILE *wlibc_fmemopen(void *restrict buffer, size_t size, const char *restrict mode)
+{
+	FILE *stream = NULL;
+	int buf_mode = _IOFBF;
+	int flags = 0;
+
+	if (mode == NULL || size == 0 || (mode[0] != 'r' && mode[0] != 'w' && mode[0] != 'a'))
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	flags = parse_mode(mode);
+
+	if (buffer == NULL)
+	{
+		// Freed when the stream is closed.
+		buffer = RtlAllocateHeap(NtCurrentProcessHeap(), HEAP_ZERO_MEMORY, size);
+
+		if (buffer == NULL)
+		{
+			errno = ENOMEM;
+			return NULL;
+		}
+
+		buf_mode |= _IOBUFFER_INTERNAL | _IOBUFFER_ALLOCATED;
+	}
+	else
+	{
+		buf_mode |= _IOBUFFER_EXTERNAL;
+	}
+
+	if (flags & O_APPEND)
+	{
+		buf_mode |= _IOBUFFER_APPEND;
+	}
+
+	stream = create_stream(FD_MEMSTREAM, buf_mode | get_buf_mode(flags), 0);
+
+	if (stream == NULL)
+	{
+		if (buf_mode & _IOBUFFER_ALLOCATED)
+		{
+			RtlFreeHeap(NtCurrentProcessHeap(), 0, buffer);
+		}
+
+		return NULL;
+	}
+
+	// The caller's buffer is used directly as the stream buffer.
+	stream->buffer = buffer;
+	stream->buf_size = size;
+
+	if (flags & O_APPEND)
+	{
+		stream->length = strnlen(stream->buffer, size);
+		stream->pos = stream->length;
+	}
+	else if (flags & O_TRUNC)
+	{
+		stream->length = 0;
+		stream->buffer[0] = '\0';
+	}
+	else
+	{
+		stream->length = size;
+	}
+
+	return stream;
+}
+
+FILE *wlibc_open_memstream(char **ptr, size_t *size)
+{
+	FILE *stream = NULL;
+	char *buffer = NULL;
+
+	if (ptr == NULL || size == NULL)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	buffer = (char *)calloc(MEMSTREAM_CHUNK_SIZE + 1, 1);
+
+	if (buffer == NULL)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	// The buffer belongs to the caller.
+	stream = create_stream(FD_MEMSTREAM, _IOFBF | _IOBUFFER_EXTERNAL | _IOBUFFER_WRONLY, 0);
+
+	if (stream == NULL)
+	{
+		free(buffer);
+		return NULL;
+	}
+
+	stream->buffer = buffer;
+	stream->buf_size = MEMSTREAM_CHUNK_SIZE;
+	stream->memptr = ptr;
+	stream->memsize = size;
+
+	*ptr = buffer;
+	*size = 0;
+
+	return stream;
+}
+
+FILE *map_stream(int fd)
+{
+	FILE *stream = NULL;
+	void *address = NULL;
+	off_t size = 0;
+
+	// The fd is left at the end, where it would be had the whole file been read.
+	size = lseek(fd, 0, SEEK_END);
+
+	// Empty files cannot be mapped.
+	if (size <= 0 || (unsigned long long)size > SIZE_MAX)
+	{
+		lseek(fd, 0, SEEK_SET);
+		return NULL;
+	}
+
+	address = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (address == MAP_FAILED)
+	{
+		lseek(fd, 0, SEEK_SET);
+		return NULL;
+	}
+
+	stream = create_stream(fd, _IOFBF | _IOBUFFER_EXTERNAL | _IOBUFFER_MAPPED | _IOBUFFER_RDONLY, 0);
+
+	if (stream == NULL)
+	{
+		munmap(address, (size_t)size);
+		return NULL;
+	}
+
+	stream->buffer = address;
+	stream->buf_size = (size_t)size;
+	stream->length = (size_t)size;
+
+	return stream;
+}
+
+void unmap_stream(FILE *stream)
+{
+	if ((stream->buf_mode & _IOBUFFER_MAPPED) == 0)
+	{
+		return;
+	}
+
+	munmap(stream->buffer, stream->buf_size);
+
+	stream->buffer = NULL;
+	stream->buf_size = 0;
+	stream->length = 0;
+	stream->buf_mode &= ~(_IOBUFFER_MAPPED | _IOBUFFER_EXTERNAL);
+}
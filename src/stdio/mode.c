@@ -34,7 +34,7 @@ int parse_mode(const char *mode)
 			flags |= O_EXCL;
 			break;
 		case 'm':
-			// flags // mmap TODO
+			// mmap, handled by fopen
 			break;
 		// Microsoft Extensions
 		case 'b':
@@ -105,7 +105,7 @@ FILE *wlibc_popen(const char *restrict command, const char *restrict mode)
 		fd = register_to_fd_table(write_end, PIPE_HANDLE, O_WRONLY);
 	}
 
-	FILE *stream = create_stream(fd, _IOBUFFER_INTERNAL | _IOFBF | get_buf_mode(pmode), 4096);
+	FILE *stream = create_stream(fd, _IOBUFFER_INTERNAL | _IOFBF | get_buf_mode(pmode), (int)stream_buffer_size(fd));
 	stream->phandle = PINFO.hProcess;
 
 	return stream;
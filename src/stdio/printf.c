@@ -9,6 +9,7 @@
 #include <internal/buffer.h>
 #include <internal/convert.h>
 #include <internal/fcntl.h>
+#include <internal/stdio.h>
 #include <internal/varargs.h>
 
 #include <errno.h>
@@ -78,6 +79,18 @@ typedef struct _print_config
 	void *data;
 } print_config;
 
+typedef struct _print_spec
+{
+	print_type type;
+	uint16_t modifier;
+	uint16_t flags;
+	uint32_t width;
+	uint32_t precision;
+	uint32_t arg_index;       // 0 for the next argument
+	uint32_t width_index;     // UINT32_MAX if width is not an argument
+	uint32_t precision_index; // UINT32_MAX if precision is not an argument
+} print_spec;
+
 static void parse_number(buffer_t *format, uint32_t *index)
 {
 	byte_t byte = 0;
@@ -98,17 +111,16 @@ static void parse_number(buffer_t *format, uint32_t *index)
 	}
 }
 
-static void parse_print_specifier(buffer_t *format, print_config *config, variadic_args *args)
+static void parse_print_specifier(buffer_t *format, print_spec *spec)
 {
 	uint32_t index = 0;
 	byte_t byte = 0;
 	size_t pos = 0;
 
-	uint32_t arg_index = 0;
-	uint32_t width_index = UINT32_MAX;
-	uint32_t precision_index = UINT32_MAX;
+	memset(spec, 0, sizeof(print_spec));
 
-	memset(config, 0, sizeof(print_config));
+	spec->width_index = UINT32_MAX;
+	spec->precision_index = UINT32_MAX;
 
 	// argument
 	pos = format->pos;
@@ -118,7 +130,7 @@ static void parse_print_specifier(buffer_t *format, print_config *config, variad
 	{
 		if (peekbyte(format, 0) == '$')
 		{
-			arg_index = index;
+			spec->arg_index = index;
 			readbyte(format);
 		}
 		else
@@ -136,41 +148,41 @@ static void parse_print_specifier(buffer_t *format, print_config *config, variad
 	{
 		if (byte == '#')
 		{
-			config->flags |= PRINT_ALTERNATE_FORM;
+			spec->flags |= PRINT_ALTERNATE_FORM;
 			readbyte(format);
 			continue;
 		}
 
 		if (byte == '0')
 		{
-			config->flags |= PRINT_ZERO_PADDED;
+			spec->flags |= PRINT_ZERO_PADDED;
 			readbyte(format);
 			continue;
 		}
 
 		if (byte == ' ')
 		{
-			config->flags |= PRINT_EMPTY_SPACE;
+			spec->flags |= PRINT_EMPTY_SPACE;
 			readbyte(format);
 			continue;
 		}
 
 		if (byte == '-')
 		{
-			config->flags |= PRINT_LEFT_JUSTIFY;
+			spec->flags |= PRINT_LEFT_JUSTIFY;
 			readbyte(format);
 			continue;
 		}
 
 		if (byte == '+')
 		{
-			config->flags |= PRINT_FORCE_SIGN;
+			spec->flags |= PRINT_FORCE_SIGN;
 			readbyte(format);
 			continue;
 		}
 		if (byte == '\'')
 		{
-			config->flags |= PRINT_GROUP_DIGITS;
+			spec->flags |= PRINT_GROUP_DIGITS;
 			readbyte(format);
 			continue;
 		}
@@ -187,17 +199,17 @@ static void parse_print_specifier(buffer_t *format, print_config *config, variad
 		if (peekbyte(format, 0) == '$')
 		{
 			readbyte(format);
-			width_index = index;
+			spec->width_index = index;
 		}
 		else
 		{
-			width_index = 0;
+			spec->width_index = 0;
 		}
 	}
 	else
 	{
 		parse_number(format, &index);
-		config->width = index;
+		spec->width = index;
 	}
 
 	// precision
@@ -213,20 +225,20 @@ static void parse_print_specifier(buffer_t *format, print_config *config, variad
 			if (peekbyte(format, 0) == '$')
 			{
 				readbyte(format);
-				precision_index = index;
+				spec->precision_index = index;
 			}
 			else
 			{
-				precision_index = 0;
+				spec->precision_index = 0;
 			}
 		}
 		else
 		{
 			parse_number(format, &index);
-			config->precision = index;
+			spec->precision = index;
 		}
 
-		config->flags |= PRINT_PRECISION;
+		spec->flags |= PRINT_PRECISION;
 	}
 
 	// length modifiers
@@ -238,12 +250,12 @@ static void parse_print_specifier(buffer_t *format, print_config *config, variad
 
 		if (peekbyte(format, 0) == 'h')
 		{
-			config->modifier = PRINT_MOD_SHORT_SHORT;
+			spec->modifier = PRINT_MOD_SHORT_SHORT;
 			readbyte(format);
 		}
 		else
 		{
-			config->modifier = PRINT_MOD_SHORT;
+			spec->modifier = PRINT_MOD_SHORT;
 		}
 	}
 	break;
@@ -253,30 +265,30 @@ static void parse_print_specifier(buffer_t *format, print_config *config, variad
 
 		if (peekbyte(format, 0) == 'l')
 		{
-			config->modifier = PRINT_MOD_LONG_LONG;
+			spec->modifier = PRINT_MOD_LONG_LONG;
 			readbyte(format);
 		}
 		else
 		{
-			config->modifier = PRINT_MOD_LONG;
+			spec->modifier = PRINT_MOD_LONG;
 		}
 	}
 	break;
 	case 'L':
 		readbyte(format);
-		config->modifier = PRINT_MOD_LONG_DOUBLE;
+		spec->modifier = PRINT_MOD_LONG_DOUBLE;
 		break;
 	case 'j':
 		readbyte(format);
-		config->modifier = PRINT_MOD_MAX;
+		spec->modifier = PRINT_MOD_MAX;
 		break;
 	case 'z':
 		readbyte(format);
-		config->modifier = PRINT_MOD_SIZE;
+		spec->modifier = PRINT_MOD_SIZE;
 		break;
 	case 't':
 		readbyte(format);
-		config->modifier = PRINT_MOD_PTRDIFF;
+		spec->modifier = PRINT_MOD_PTRDIFF;
 		break;
 	}
 
@@ -286,103 +298,250 @@ static void parse_print_specifier(buffer_t *format, print_config *config, variad
 	// integer
 	case 'i':
 	case 'd':
-		config->type = PRINT_INT_NUMBER;
+		spec->type = PRINT_INT_NUMBER;
 		break;
 	case 'u':
-		config->type = PRINT_UINT_NUMBER;
+		spec->type = PRINT_UINT_NUMBER;
 		break;
 	case 'B':
-		config->flags |= PRINT_UPPER_CASE;
+		spec->flags |= PRINT_UPPER_CASE;
 	case 'b':
-		config->type = PRINT_UINT_BINARY;
+		spec->type = PRINT_UINT_BINARY;
 		break;
 	case 'O':
-		config->flags |= PRINT_UPPER_CASE;
+		spec->flags |= PRINT_UPPER_CASE;
 	case 'o':
-		config->type = PRINT_UINT_OCTAL;
+		spec->type = PRINT_UINT_OCTAL;
 		break;
 	case 'X':
-		config->flags |= PRINT_UPPER_CASE;
+		spec->flags |= PRINT_UPPER_CASE;
 	case 'x':
-		config->type = PRINT_UINT_HEX;
+		spec->type = PRINT_UINT_HEX;
 		break;
 
 	// float
 	case 'A':
-		config->flags |= PRINT_UPPER_CASE;
+		spec->flags |= PRINT_UPPER_CASE;
 	case 'a':
-		config->type = PRINT_DOUBLE_HEX;
+		spec->type = PRINT_DOUBLE_HEX;
 		break;
 	case 'F':
-		config->flags |= PRINT_UPPER_CASE;
+		spec->flags |= PRINT_UPPER_CASE;
 	case 'f':
-		config->type = PRINT_DOUBLE_NORMAL;
+		spec->type = PRINT_DOUBLE_NORMAL;
 		break;
 	case 'E':
-		config->flags |= PRINT_UPPER_CASE;
+		spec->flags |= PRINT_UPPER_CASE;
 	case 'e':
-		config->type = PRINT_DOUBLE_SCIENTIFIC;
+		spec->type = PRINT_DOUBLE_SCIENTIFIC;
 		break;
 	case 'G':
-		config->flags |= PRINT_UPPER_CASE;
+		spec->flags |= PRINT_UPPER_CASE;
 	case 'g':
-		config->type = PRINT_DOUBLE_SCIENTIFIC_SHORT;
+		spec->type = PRINT_DOUBLE_SCIENTIFIC_SHORT;
 		break;
 
 	// misc
 	case 'c':
-		config->type = PRINT_CHAR;
+		spec->type = PRINT_CHAR;
 		break;
 	case 's':
-		config->type = PRINT_STRING;
+		spec->type = PRINT_STRING;
 		break;
 	case 'p':
-		config->type = PRINT_POINTER;
+		spec->type = PRINT_POINTER;
 		break;
 	case 'n':
-		config->type = PRINT_RESULT;
+		spec->type = PRINT_RESULT;
 		break;
 
 	default:
-		config->type = PRINT_UNKNOWN;
+		spec->type = PRINT_UNKNOWN;
 		break;
 	}
 
-	if (config->type != PRINT_UNKNOWN)
+	if (spec->type != PRINT_UNKNOWN)
 	{
-		// get the argument from the list
 		readbyte(format);
+	}
 
-		if (width_index != UINT32_MAX)
-		{
-			config->width = (uint32_t)(uintptr_t)variadic_args_get(args, width_index);
-		}
+	// If both '-' and '0' are given '0' is ignored.
+	if (spec->flags & PRINT_LEFT_JUSTIFY)
+	{
+		spec->flags &= ~PRINT_ZERO_PADDED;
+	}
+
+	// Ignore '0' if precision is given (only for integers)
+	if ((spec->flags & PRINT_PRECISION) && spec->type <= PRINT_UINT_HEX)
+	{
+		spec->flags &= ~PRINT_ZERO_PADDED;
+	}
 
-		if (precision_index != UINT32_MAX)
+	//  If both '+' and ' ' are given ' ' is ignored.
+	if (spec->flags & PRINT_FORCE_SIGN)
+	{
+		spec->flags &= ~PRINT_EMPTY_SPACE;
+	}
+}
+
+static uint8_t print_arg_type(const print_spec *spec)
+{
+	switch (spec->type)
+	{
+	case PRINT_DOUBLE_NORMAL:
+	case PRINT_DOUBLE_HEX:
+	case PRINT_DOUBLE_SCIENTIFIC:
+	case PRINT_DOUBLE_SCIENTIFIC_SHORT:
+		return VARIADIC_ARG_DOUBLE;
+	case PRINT_STRING:
+	case PRINT_POINTER:
+	case PRINT_RESULT:
+		return VARIADIC_ARG_POINTER;
+	case PRINT_CHAR:
+		return VARIADIC_ARG_INT;
+	default:
+		switch (spec->modifier)
 		{
-			config->precision = (uint32_t)(uintptr_t)variadic_args_get(args, precision_index);
+		case PRINT_MOD_LONG:
+		case PRINT_MOD_LONG_LONG:
+		case PRINT_MOD_MAX:
+		case PRINT_MOD_SIZE:
+		case PRINT_MOD_PTRDIFF:
+			return VARIADIC_ARG_INT64;
+		default:
+			return VARIADIC_ARG_INT;
 		}
+	}
+}
 
-		config->data = variadic_args_get(args, arg_index);
+static void resolve_print_spec(const print_spec *spec, print_config *config, variadic_args *args)
+{
+	config->type = spec->type;
+	config->modifier = spec->modifier;
+	config->flags = spec->flags;
+	config->width = spec->width;
+	config->precision = spec->precision;
+	config->result = 0;
+
+	// get the arguments from the list
+	if (spec->width_index != UINT32_MAX)
+	{
+		config->width = (uint32_t)(uintptr_t)variadic_args_get(args, spec->width_index, VARIADIC_ARG_INT);
 	}
 
-	// If both '-' and '0' are given '0' is ignored.
-	if (config->flags & PRINT_LEFT_JUSTIFY)
+	if (spec->precision_index != UINT32_MAX)
 	{
-		config->flags &= ~PRINT_ZERO_PADDED;
+		config->precision = (uint32_t)(uintptr_t)variadic_args_get(args, spec->precision_index, VARIADIC_ARG_INT);
 	}
 
-	// Ignore '0' if precision is given
-	if (config->flags & PRINT_PRECISION)
+	config->data = variadic_args_get(args, spec->arg_index, print_arg_type(spec));
+}
+
+static void print_set_arg_type(uint8_t *types, uint32_t capacity, uint32_t *count, uint32_t position, uint8_t type)
+{
+	if (position <= capacity)
 	{
-		config->flags &= ~PRINT_ZERO_PADDED;
+		types[position - 1] = type;
 	}
 
-	//  If both '+' and ' ' are given ' ' is ignored.
-	if (config->flags & PRINT_FORCE_SIGN)
+	*count = MAX(*count, position);
+}
+
+static void print_spec_arg_types(const print_spec *spec, uint8_t *types, uint32_t capacity, uint32_t *count, uint32_t *next)
+{
+	// Same order as resolve_print_spec
+	if (spec->width_index != UINT32_MAX)
+	{
+		print_set_arg_type(types, capacity, count, spec->width_index != 0 ? spec->width_index : ++*next, VARIADIC_ARG_INT);
+	}
+
+	if (spec->precision_index != UINT32_MAX)
+	{
+		print_set_arg_type(types, capacity, count, spec->precision_index != 0 ? spec->precision_index : ++*next, VARIADIC_ARG_INT);
+	}
+
+	print_set_arg_type(types, capacity, count, spec->arg_index != 0 ? spec->arg_index : ++*next, print_arg_type(spec));
+}
+
+static uint8_t print_spec_positional(const print_spec *spec)
+{
+	return (spec->arg_index != 0) || (spec->width_index != 0 && spec->width_index != UINT32_MAX) ||
+		   (spec->precision_index != 0 && spec->precision_index != UINT32_MAX);
+}
+
+// Returns the number of arguments consumed by the format, types beyond capacity are not stored.
+static uint32_t print_collect_arg_types(const char *format, uint8_t *types, uint32_t capacity)
+{
+	buffer_t in = {.data = (void *)format, .pos = 0, .size = 0, .read = string_buffer_read};
+	print_spec spec = {0};
+	uint32_t count = 0;
+	uint32_t next = 0;
+	size_t pos = 0;
+
+	if (capacity != 0)
+	{
+		memset(types, 0, capacity);
+	}
+
+	while (fill(&in, 1) != 0)
+	{
+		advance(&in, literal_span(&in, 0));
+
+		if (pending(&in) == 0)
+		{
+			continue;
+		}
+
+		readbyte(&in);
+
+		if (peekbyte(&in, 0) == '%')
+		{
+			readbyte(&in);
+			continue;
+		}
+
+		pos = in.pos;
+		parse_print_specifier(&in, &spec);
+
+		if (spec.type == PRINT_UNKNOWN)
+		{
+			in.pos = pos;
+			continue;
+		}
+
+		print_spec_arg_types(&spec, types, capacity, &count, &next);
+	}
+
+	return count;
+}
+
+static int print_load_args(variadic_args *args, const char *format)
+{
+	uint8_t types[VARIADIC_ARGS_DEFAULT_SIZE];
+	uint8_t *more = NULL;
+	uint32_t count = 0;
+	int result = 0;
+
+	count = print_collect_arg_types(format, types, VARIADIC_ARGS_DEFAULT_SIZE);
+
+	if (count <= VARIADIC_ARGS_DEFAULT_SIZE)
+	{
+		return variadic_args_load(args, types, count);
+	}
+
+	more = malloc(count);
+
+	if (more == NULL)
 	{
-		config->flags &= ~PRINT_EMPTY_SPACE;
+		return -1;
 	}
+
+	print_collect_arg_types(format, more, count);
+	result = variadic_args_load(args, more, count);
+
+	free(more);
+
+	return result;
 }
 
 static byte_t alternate_form_char(print_config *config)
@@ -644,6 +803,235 @@ static uint32_t print_uint_formatted(print_config *config, buffer_t *buffer, byt
 	return result;
 }
 
+static void print_repeat(buffer_t *buffer, byte_t byte, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		writebyte(buffer, byte);
+	}
+}
+
+static void print_decimal_digits(buffer_t *buffer, float_decimal *decimal, int32_t start, int32_t end)
+{
+	// Digits outside [0, count) are zeros.
+	while (start < end && start < 0)
+	{
+		writebyte(buffer, '0');
+		start += 1;
+	}
+
+	if (start < end && start < (int32_t)decimal->count)
+	{
+		int32_t stop = MIN(end, (int32_t)decimal->count);
+
+		writen(buffer, decimal->digits + start, stop - start);
+		start = stop;
+	}
+
+	while (start < end)
+	{
+		writebyte(buffer, '0');
+		start += 1;
+	}
+}
+
+static uint32_t print_float_formatted(print_config *config, buffer_t *buffer, float_decimal *decimal)
+{
+	uint32_t upper = config->flags & PRINT_UPPER_CASE;
+	uint32_t precision = 0;
+	uint32_t size = 0;
+	uint8_t scientific = 0;
+	byte_t sign = 0;
+
+	byte_t exponent[32] = {0};
+	uint32_t exponent_size = 0;
+	uint32_t integer_size = 0;
+	uint32_t group_size = 0;
+
+	if (decimal->sign)
+	{
+		sign = '-';
+	}
+	else if (config->flags & PRINT_FORCE_SIGN)
+	{
+		sign = '+';
+	}
+	else if (config->flags & PRINT_EMPTY_SPACE)
+	{
+		sign = ' ';
+	}
+
+	if (decimal->special != FLOAT_FINITE)
+	{
+		size = 3 + (sign != 0);
+
+		if ((config->flags & PRINT_LEFT_JUSTIFY) == 0)
+		{
+			print_repeat(buffer, ' ', config->width > size ? config->width - size : 0);
+		}
+
+		if (sign)
+		{
+			writebyte(buffer, sign);
+		}
+
+		if (decimal->special == FLOAT_INF)
+		{
+			writen(buffer, upper ? "INF" : "inf", 3);
+		}
+		else
+		{
+			writen(buffer, upper ? "NAN" : "nan", 3);
+		}
+
+		if (config->flags & PRINT_LEFT_JUSTIFY)
+		{
+			print_repeat(buffer, ' ', config->width > size ? config->width - size : 0);
+		}
+
+		return MAX(config->width, size);
+	}
+
+	// The digits have already been rounded to the requested precision.
+	if (config->type == PRINT_DOUBLE_NORMAL)
+	{
+		precision = config->precision;
+	}
+
+	if (config->type == PRINT_DOUBLE_SCIENTIFIC)
+	{
+		precision = config->precision;
+		scientific = 1;
+	}
+
+	if (config->type == PRINT_DOUBLE_SCIENTIFIC_SHORT)
+	{
+		// Use scientific notation only if the exponent is less than -4 or greater than or equal to the precision.
+		uint32_t significant = config->precision;
+
+		if (decimal->exponent < -4 || decimal->exponent >= (int32_t)significant)
+		{
+			scientific = 1;
+			precision = significant - 1;
+		}
+		else
+		{
+			precision = significant - 1 - decimal->exponent;
+		}
+
+		// Remove trailing zeros
+		if ((config->flags & PRINT_ALTERNATE_FORM) == 0)
+		{
+			int32_t fraction = (int32_t)decimal->count - 1 - (scientific ? 0 : decimal->exponent);
+
+			precision = MIN(precision, (uint32_t)MAX(fraction, 0));
+		}
+	}
+
+	if (scientific)
+	{
+		int32_t value = decimal->exponent;
+
+		exponent[exponent_size++] = upper ? 'E' : 'e';
+		exponent[exponent_size++] = value < 0 ? '-' : '+';
+
+		if (value < 0)
+		{
+			value = -value;
+		}
+
+		// Atleast 2 digits
+		if (value < 10)
+		{
+			exponent[exponent_size++] = '0';
+		}
+
+		exponent_size += uint_to_dec_common(exponent + exponent_size, value, 0);
+		integer_size = 1;
+	}
+	else
+	{
+		integer_size = MAX(decimal->exponent, 0) + 1;
+
+		if (config->flags & PRINT_GROUP_DIGITS)
+		{
+			group_size = (integer_size - 1) / 3;
+		}
+	}
+
+	size = (sign != 0) + integer_size + group_size + exponent_size + precision;
+
+	if (precision > 0 || (config->flags & PRINT_ALTERNATE_FORM))
+	{
+		size += 1;
+	}
+
+	if ((config->flags & (PRINT_LEFT_JUSTIFY | PRINT_ZERO_PADDED)) == 0)
+	{
+		print_repeat(buffer, ' ', config->width > size ? config->width - size : 0);
+	}
+
+	if (sign)
+	{
+		writebyte(buffer, sign);
+	}
+
+	if (config->flags & PRINT_ZERO_PADDED)
+	{
+		print_repeat(buffer, '0', config->width > size ? config->width - size : 0);
+	}
+
+	if (scientific)
+	{
+		print_decimal_digits(buffer, decimal, 0, 1);
+	}
+	else
+	{
+		int32_t start = decimal->exponent + 1 - integer_size;
+
+		if (group_size > 0)
+		{
+			uint32_t group = integer_size % 3 == 0 ? 3 : integer_size % 3;
+
+			print_decimal_digits(buffer, decimal, start, start + group);
+			start += group;
+
+			for (uint32_t i = 0; i < group_size; ++i)
+			{
+				writebyte(buffer, ',');
+				print_decimal_digits(buffer, decimal, start, start + 3);
+				start += 3;
+			}
+		}
+		else
+		{
+			print_decimal_digits(buffer, decimal, start, start + integer_size);
+		}
+	}
+
+	if (precision > 0 || (config->flags & PRINT_ALTERNATE_FORM))
+	{
+		writebyte(buffer, '.');
+	}
+
+	if (scientific)
+	{
+		print_decimal_digits(buffer, decimal, 1, 1 + precision);
+		writen(buffer, exponent, exponent_size);
+	}
+	else
+	{
+		print_decimal_digits(buffer, decimal, decimal->exponent + 1, decimal->exponent + 1 + precision);
+	}
+
+	if (config->flags & PRINT_LEFT_JUSTIFY)
+	{
+		print_repeat(buffer, ' ', config->width > size ? config->width - size : 0);
+	}
+
+	return MAX(config->width, size);
+}
+
 static uint32_t print_arg(buffer_t *buffer, print_config *config)
 {
 	byte_t temp[128] = {0};
@@ -838,18 +1226,37 @@ static uint32_t print_arg(buffer_t *buffer, print_config *config)
 		return print_uint_formatted(config, buffer, temp, size);
 	}
 
-	if (config->type == PRINT_DOUBLE_NORMAL)
+	if (config->type == PRINT_DOUBLE_NORMAL || config->type == PRINT_DOUBLE_SCIENTIFIC ||
+		config->type == PRINT_DOUBLE_SCIENTIFIC_SHORT)
 	{
-		return 0;
-	}
+		float_decimal decimal;
 
-	if (config->type == PRINT_DOUBLE_SCIENTIFIC || config->type == PRINT_DOUBLE_SCIENTIFIC_SHORT)
-	{
-		if (config->type == PRINT_DOUBLE_SCIENTIFIC_SHORT)
+		// Default precision is 6.
+		if ((config->flags & PRINT_PRECISION) == 0 || config->precision > INT32_MAX)
 		{
+			config->precision = 6;
 		}
 
-		return 0;
+		switch (config->type)
+		{
+		case PRINT_DOUBLE_NORMAL:
+			float64_to_decimal(&decimal, VIEW_AS(config->data, double), FLOAT_MODE_FRACTION, config->precision);
+			break;
+		case PRINT_DOUBLE_SCIENTIFIC:
+			float64_to_decimal(&decimal, VIEW_AS(config->data, double), FLOAT_MODE_SIGNIFICANT, config->precision + 1);
+			break;
+		default:
+			// A precision of 0 is treated as 1.
+			if (config->precision == 0)
+			{
+				config->precision = 1;
+			}
+
+			float64_to_decimal(&decimal, VIEW_AS(config->data, double), FLOAT_MODE_SIGNIFICANT, config->precision);
+			break;
+		}
+
+		return print_float_formatted(config, buffer, &decimal);
 	}
 
 	if (config->type == PRINT_DOUBLE_HEX)
@@ -1005,27 +1412,25 @@ static uint32_t print_arg(buffer_t *buffer, print_config *config)
 		break;
 		case PRINT_MOD_LONG:
 		{
-			uint32_t codepoint = 0;
-			pos = 0;
+			uint16_t *in = config->data;
+			size_t remaining = count;
+			size_t consumed = 0;
 
-			for (uint32_t i = 0; i < count; ++i)
+			// Transcode in chunks, stopping at an invalid sequence.
+			while (remaining > 0)
 			{
-				size = utf16_decode(PTR_OFFSET(config->data, pos), 4, &codepoint);
-				pos += size;
+				size = (uint32_t)utf16_to_utf8(in, remaining, temp, sizeof(temp), &consumed);
 
-				if (size == 4)
-				{
-					++i;
-				}
-
-				if (codepoint == 0)
+				if (consumed == 0)
 				{
 					break;
 				}
 
-				size = utf8_encode(temp, codepoint);
 				writen(buffer, temp, size);
 				result += size;
+
+				in += consumed;
+				remaining -= consumed;
 			}
 		}
 		break;
@@ -1142,21 +1547,382 @@ static uint32_t print_arg(buffer_t *buffer, print_config *config)
 	return 0;
 }
 
-int wlibc_printf_internal(buffer_t *buffer, const char *format, va_list list)
-{
-	variadic_args args = {0};
-	print_config config = {0};
-	buffer_t in = {.data = (void *)format, .pos = 0, .size = strnlen(format, 65536)};
+/*
+   Compiled format programs.
 
-	uint32_t result = 0;
-	byte_t byte = 0;
-	size_t pos = 0;
+   A program is a sequence of literal runs each followed by an optional conversion, along with a copy of the format
+   string and the types of the arguments it consumes. Programs are immutable once compiled and reference counted, so
+   that they can be shared by the format cache and its users.
+*/
 
-	variadic_args_init(&args, list);
+typedef struct _print_op
+{
+	uint32_t offset; // literal run
+	uint32_t size;
+	print_spec spec; // type is 0 if there is no conversion
+} print_op;
 
-	while ((byte = readbyte(&in)) != '\0')
+struct _printf_program
+{
+	volatile long references;
+	uint32_t length;
+	uint32_t count;
+	uint32_t positional;
+	uint32_t arg_count;
+	uint8_t *arg_types;
+	print_op *ops;
+	char *format;
+};
+
+static printf_program *print_program_compile(const char *format)
+{
+	printf_program *program = NULL;
+	buffer_t in = {0};
+	print_spec spec = {0};
+
+	size_t length = strlen(format);
+	uint32_t bound = 1;
+	uint32_t start = 0;
+	uint32_t next = 0;
+	uint32_t arg_count = 0;
+	size_t size = 0;
+
+	if (length >= UINT32_MAX)
 	{
-		if (byte == '%')
+		errno = EOVERFLOW;
+		return NULL;
+	}
+
+	// Each '%' can end atmost one literal run.
+	in = (buffer_t){.data = (void *)format, .pos = 0, .size = length};
+
+	while (in.pos < in.size)
+	{
+		in.pos += literal_span(&in, 0);
+
+		if (in.pos < in.size)
+		{
+			in.pos += 1;
+			bound += 1;
+		}
+	}
+
+	arg_count = print_collect_arg_types(format, NULL, 0);
+	size = sizeof(printf_program) + (sizeof(print_op) * bound) + arg_count + length + 1;
+	program = malloc(size);
+
+	if (program == NULL)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	memset(program, 0, size);
+
+	program->references = 1;
+	program->length = (uint32_t)length;
+	program->ops = (print_op *)PTR_OFFSET(program, sizeof(printf_program));
+	program->arg_types = (uint8_t *)PTR_OFFSET(program->ops, sizeof(print_op) * bound);
+	program->format = (char *)PTR_OFFSET(program->arg_types, arg_count);
+
+	memcpy(program->format, format, length + 1);
+
+	in = (buffer_t){.data = (void *)program->format, .pos = 0, .size = length};
+
+	while (in.pos < in.size)
+	{
+		size_t pos = 0;
+		print_op *op = NULL;
+
+		in.pos += literal_span(&in, 0);
+
+		if (readbyte(&in) != '%')
+		{
+			break;
+		}
+
+		// Trailing '%'
+		if (in.pos == in.size)
+		{
+			break;
+		}
+
+		// '%%' ends the literal run after the first '%'
+		if (peekbyte(&in, 0) == '%')
+		{
+			op = &program->ops[program->count++];
+			op->offset = start;
+			op->size = (uint32_t)(in.pos - start);
+
+			readbyte(&in);
+			start = (uint32_t)in.pos;
+
+			continue;
+		}
+
+		pos = in.pos;
+		parse_print_specifier(&in, &spec);
+
+		// Unknown conversions are printed as is.
+		if (spec.type == PRINT_UNKNOWN)
+		{
+			in.pos = pos;
+			continue;
+		}
+
+		op = &program->ops[program->count++];
+		op->offset = start;
+		op->size = (uint32_t)(pos - 1 - start);
+		op->spec = spec;
+
+		print_spec_arg_types(&spec, program->arg_types, arg_count, &program->arg_count, &next);
+		program->positional |= print_spec_positional(&spec);
+
+		start = (uint32_t)in.pos;
+	}
+
+	if (start < length)
+	{
+		print_op *op = &program->ops[program->count++];
+
+		op->offset = start;
+		op->size = (uint32_t)(length - start);
+	}
+
+	return program;
+}
+
+static void print_program_release(printf_program *program)
+{
+	if (_InterlockedDecrement(&program->references) == 0)
+	{
+		free(program);
+	}
+}
+
+static int print_program_run(buffer_t *buffer, const printf_program *program, va_list list)
+{
+	variadic_args args;
+	print_config config = {0};
+	uint32_t result = 0;
+
+	variadic_args_init(&args, list);
+
+	if (program->positional)
+	{
+		if (variadic_args_load(&args, program->arg_types, program->arg_count) == -1)
+		{
+			variadic_args_free(&args);
+			return -1;
+		}
+	}
+
+	for (uint32_t i = 0; i < program->count; ++i)
+	{
+		const print_op *op = &program->ops[i];
+
+		if (op->size != 0)
+		{
+			writen(buffer, program->format + op->offset, op->size);
+			result += op->size;
+		}
+
+		if (op->spec.type != 0)
+		{
+			resolve_print_spec(&op->spec, &config, &args);
+
+			config.result = result;
+			result += print_arg(buffer, &config);
+		}
+
+		if (buffer->error)
+		{
+			variadic_args_free(&args);
+			return -1;
+		}
+	}
+
+	variadic_args_free(&args);
+
+	return (int)result;
+}
+
+/*
+   Format cache.
+
+   Programs are cached by the address of the format string, with a small set associative LRU.
+   Format strings are compiled only when their address is seen a second time, so that formats which are used once
+   are not compiled. As the same address can hold a different format later, a cached program is used only if its
+   copy of the format string matches.
+   Each set has its own lock and clock, and is aligned to a cache line. Hits update the clock and the stamps with
+   interlocked operations under the shared lock, so the LRU order is only approximate when threads race on a set.
+   Short formats are interpreted directly, compiling them does not save more than the lookup costs.
+*/
+
+#define PRINT_CACHE_SETS       16
+#define PRINT_CACHE_WAYS       4
+#define PRINT_CACHE_MIN_LENGTH 16
+
+typedef struct _print_cache_entry
+{
+	const char *format;
+	printf_program *program;
+	volatile long stamp;
+} print_cache_entry;
+
+typedef struct __declspec(align(64)) _print_cache_set
+{
+	RTL_SRWLOCK lock;
+	const char *volatile candidate;
+	volatile long clock;
+	print_cache_entry entries[PRINT_CACHE_WAYS];
+} print_cache_set;
+
+static print_cache_set print_cache[PRINT_CACHE_SETS];
+
+static print_cache_set *print_cache_find_set(const char *format)
+{
+	uintptr_t hash = (uintptr_t)format;
+
+	hash ^= hash >> 4;
+	hash ^= hash >> 12;
+
+	return &print_cache[hash % PRINT_CACHE_SETS];
+}
+
+static void print_cache_insert(print_cache_set *set, const char *format, printf_program *program)
+{
+	printf_program *evicted = NULL;
+	print_cache_entry *entry = NULL;
+
+	RtlAcquireSRWLockExclusive(&set->lock);
+
+	for (uint32_t i = 0; i < PRINT_CACHE_WAYS; ++i)
+	{
+		// Replace stale programs of the same address.
+		if (set->entries[i].format == format)
+		{
+			entry = &set->entries[i];
+			break;
+		}
+
+		if (entry == NULL || set->entries[i].stamp < entry->stamp)
+		{
+			entry = &set->entries[i];
+		}
+	}
+
+	evicted = entry->program;
+
+	_InterlockedIncrement(&program->references);
+
+	entry->format = format;
+	entry->program = program;
+	entry->stamp = ++set->clock;
+
+	RtlReleaseSRWLockExclusive(&set->lock);
+
+	if (evicted != NULL)
+	{
+		print_program_release(evicted);
+	}
+}
+
+static printf_program *print_cache_get(const char *format)
+{
+	print_cache_set *set = NULL;
+	printf_program *program = NULL;
+
+	if (strnlen(format, PRINT_CACHE_MIN_LENGTH) < PRINT_CACHE_MIN_LENGTH)
+	{
+		return NULL;
+	}
+
+	set = print_cache_find_set(format);
+
+	RtlAcquireSRWLockShared(&set->lock);
+
+	for (uint32_t i = 0; i < PRINT_CACHE_WAYS; ++i)
+	{
+		if (set->entries[i].format == format)
+		{
+			program = set->entries[i].program;
+			_InterlockedIncrement(&program->references);
+
+			// Repeated hits on the most recent entry do not write to the set.
+			if (set->entries[i].stamp != set->clock)
+			{
+				_InterlockedExchange(&set->entries[i].stamp, _InterlockedIncrement(&set->clock));
+			}
+
+			break;
+		}
+	}
+
+	RtlReleaseSRWLockShared(&set->lock);
+
+	if (program != NULL)
+	{
+		if (strncmp(program->format, format, program->length + 1) == 0)
+		{
+			return program;
+		}
+
+		print_program_release(program);
+	}
+	else
+	{
+		// First sighting
+		if (set->candidate != format)
+		{
+			set->candidate = format;
+			return NULL;
+		}
+	}
+
+	program = print_program_compile(format);
+
+	if (program != NULL)
+	{
+		print_cache_insert(set, format, program);
+	}
+
+	return program;
+}
+
+static int print_interpret(buffer_t *buffer, const char *format, va_list list)
+{
+	variadic_args args;
+	print_config config = {0};
+	print_spec spec = {0};
+	buffer_t in = {.data = (void *)format, .pos = 0, .size = 0, .read = string_buffer_read};
+
+	uint32_t result = 0;
+	byte_t byte = 0;
+	size_t count = 0;
+	size_t pos = 0;
+
+	variadic_args_init(&args, list);
+
+	while (fill(&in, 1) != 0)
+	{
+		// Copy the literal run upto the next '%' at once.
+		count = literal_span(&in, 0);
+
+		if (count != 0)
+		{
+			writen(buffer, current(&in), count);
+			advance(&in, count);
+			result += (uint32_t)count;
+		}
+
+		// The run continues in the next chunk.
+		if (pending(&in) == 0)
+		{
+			continue;
+		}
+
+		if ((byte = readbyte(&in)) == '%')
 		{
 			byte = peekbyte(&in, 0);
 
@@ -1178,9 +1944,9 @@ int wlibc_printf_internal(buffer_t *buffer, const char *format, va_list list)
 			}
 
 			pos = in.pos;
-			parse_print_specifier(&in, &config, &args);
+			parse_print_specifier(&in, &spec);
 
-			if (config.type == PRINT_UNKNOWN)
+			if (spec.type == PRINT_UNKNOWN)
 			{
 				in.pos = pos;
 				writebyte(buffer, '%');
@@ -1189,63 +1955,256 @@ int wlibc_printf_internal(buffer_t *buffer, const char *format, va_list list)
 				continue;
 			}
 
+			// Read all the arguments with their types once positional arguments are seen.
+			if (args.values == NULL && print_spec_positional(&spec))
+			{
+				if (print_load_args(&args, format) == -1)
+				{
+					variadic_args_free(&args);
+					return -1;
+				}
+			}
+
+			resolve_print_spec(&spec, &config, &args);
+
 			config.result = result;
 			result += print_arg(buffer, &config);
 
 			if (buffer->error)
 			{
+				variadic_args_free(&args);
 				return -1;
 			}
 
 			continue;
 		}
-
-		writebyte(buffer, byte);
-		result += 1;
 	}
 
 	variadic_args_free(&args);
 
+	if (buffer->error)
+	{
+		return -1;
+	}
+
 	return (int)result;
 }
 
-int wlibc_vfprintf(FILE *restrict stream, const char *restrict format, va_list args)
+int wlibc_printf_internal(buffer_t *buffer, const char *format, va_list list)
 {
+	printf_program *program = print_cache_get(format);
 	int result = 0;
-	size_t fresult = 0;
-	buffer_t out = {.write = memory_buffer_write};
 
+	if (program == NULL)
+	{
+		return print_interpret(buffer, format, list);
+	}
+
+	result = print_program_run(buffer, program, list);
+	print_program_release(program);
+
+	return result;
+}
+
+
+printf_program *wlibc_printf_compile(const char *format)
+{
 	if (format == NULL)
 	{
 		errno = EINVAL;
-		return -1;
+		return NULL;
+	}
+
+	return print_program_compile(format);
+}
+
+void wlibc_printf_free(printf_program *program)
+{
+	if (program != NULL)
+	{
+		print_program_release(program);
+	}
+}
+
+int common_fflush(FILE *stream);
+int common_fwrite_begin(FILE *stream);
+size_t common_fwrite(const void *restrict buffer, size_t size, size_t count, FILE *restrict stream);
+
+#define PRINT_CHUNK_SIZE 4096
+
+static size_t stream_buffer_write(buffer_t *buffer, size_t size)
+{
+	FILE *stream = (FILE *)buffer->ctx;
+	size_t transferred = buffer->pos;
+
+	stream->pos = stream->start + buffer->pos;
+
+	if (stream->fd == FD_MEMSTREAM)
+	{
+		// Memory streams are written in place, grow them if possible.
+		if (memstream_reserve(stream, size) == 0)
+		{
+			buffer->error = 1;
+			return 0;
+		}
+
+		buffer->data = (uint8_t *)stream->buffer;
+		buffer->size = stream->end;
+
+		return buffer->size;
+	}
+
+	if (common_fflush(stream) == -1)
+	{
+		buffer->error = 1;
+		return 0;
+	}
+
+	adapt_stream_buffer(stream, transferred);
+
+	// The whole stream buffer is available again.
+	stream->start = stream->pos;
+	stream->end = stream->pos + stream->buf_size;
+
+	buffer->data = (uint8_t *)stream->buffer;
+	buffer->pos = 0;
+	buffer->size = stream->buf_size;
+
+	return buffer->size;
+}
+
+static size_t stream_chunk_write(buffer_t *buffer, size_t size)
+{
+	FILE *stream = (FILE *)buffer->ctx;
+
+	UNREFERENCED_PARAMETER(size);
+
+	if (buffer->pos > 0)
+	{
+		if (common_fwrite(buffer->data, 1, buffer->pos, stream) != buffer->pos)
+		{
+			buffer->error = 1;
+			return 0;
+		}
+
+		buffer->pos = 0;
+	}
+
+	return buffer->size;
+}
+
+static size_t fd_chunk_write(buffer_t *buffer, size_t size)
+{
+	int fd = (int)(intptr_t)buffer->ctx;
+
+	UNREFERENCED_PARAMETER(size);
+
+	if (buffer->pos > 0)
+	{
+		if (write(fd, buffer->data, buffer->pos) == -1)
+		{
+			buffer->error = 1;
+			return 0;
+		}
+
+		buffer->pos = 0;
+	}
+
+	return buffer->size;
+}
+
+static int print_dispatch(buffer_t *buffer, const char *format, const printf_program *program, va_list args)
+{
+	if (program != NULL)
+	{
+		return print_program_run(buffer, program, args);
+	}
+
+	return wlibc_printf_internal(buffer, format, args);
+}
+
+static int common_vfprintf(FILE *restrict stream, const char *restrict format, const printf_program *restrict program, va_list args)
+{
+	int result = 0;
+	BOOLEAN locked;
+
+	LOCK_FILE_STREAM(stream, &locked);
+
+	if ((stream->buf_mode & (_IONBF | _IOBUFFER_RDONLY)) == 0)
+	{
+		// Format directly into the stream buffer.
+		if (stream->error == _IOERROR || common_fwrite_begin(stream) == -1)
+		{
+			UNLOCK_FILE_STREAM(stream, locked);
+			return -1;
+		}
+
+		buffer_t out = {.data = (uint8_t *)stream->buffer,
+						.pos = stream->pos - stream->start,
+						.size = stream->end - stream->start,
+						.ctx = stream,
+						.write = stream_buffer_write};
+
+		result = print_dispatch(&out, format, program, args);
+		stream->pos = stream->start + out.pos;
+
+		if (out.error)
+		{
+			result = -1;
+		}
 	}
+	else
+	{
+		// Unbuffered streams are written in chunks, common_fwrite handles the errors for read only streams.
+		uint8_t chunk[PRINT_CHUNK_SIZE];
+		buffer_t out = {.data = chunk, .pos = 0, .size = PRINT_CHUNK_SIZE, .ctx = stream, .write = stream_chunk_write};
+
+		result = print_dispatch(&out, format, program, args);
+		stream_chunk_write(&out, 0);
+
+		if (out.error)
+		{
+			result = -1;
+		}
+	}
+
+	UNLOCK_FILE_STREAM(stream, locked);
 
-	if (stream == NULL)
+	return result;
+}
+
+int wlibc_vfprintf(FILE *restrict stream, const char *restrict format, va_list args)
+{
+	if (format == NULL)
 	{
 		errno = EINVAL;
 		return -1;
 	}
 
-	result = wlibc_printf_internal(&out, format, args);
-	fresult = fwrite(out.data, 1, out.pos, stream);
+	VALIDATE_FILE_STREAM(stream, -1);
 
-	free(out.data);
+	return common_vfprintf(stream, format, NULL, args);
+}
 
-	if (fresult == 0)
+int wlibc_vfprintf_compiled(FILE *restrict stream, const printf_program *restrict program, va_list args)
+{
+	if (program == NULL)
 	{
+		errno = EINVAL;
 		return -1;
 	}
 
-	return result;
+	VALIDATE_FILE_STREAM(stream, -1);
+
+	return common_vfprintf(stream, NULL, program, args);
 }
 
 int wlibc_vdprintf(int fd, const char *restrict format, va_list args)
 {
 	int result = 0;
-	ssize_t fresult = 0;
 	fdinfo info = {0};
-	buffer_t out = {.write = memory_buffer_write};
+	uint8_t chunk[PRINT_CHUNK_SIZE];
+	buffer_t out = {.data = chunk, .pos = 0, .size = PRINT_CHUNK_SIZE, .ctx = (void *)(intptr_t)fd, .write = fd_chunk_write};
 
 	if (format == NULL)
 	{
@@ -1262,11 +2221,9 @@ int wlibc_vdprintf(int fd, const char *restrict format, va_list args)
 	}
 
 	result = wlibc_printf_internal(&out, format, args);
-	fresult = write(fd, out.data, out.pos);
-
-	free(out.data);
+	fd_chunk_write(&out, 0);
 
-	if (fresult == -1)
+	if (out.error)
 	{
 		return -1;
 	}
@@ -1277,7 +2234,9 @@ int wlibc_vdprintf(int fd, const char *restrict format, va_list args)
 int wlibc_vasprintf(char **restrict buffer, const char *restrict format, va_list args)
 {
 	int result = 0;
-	buffer_t out = {.write = memory_buffer_write};
+	uint8_t initial[PRINT_CHUNK_SIZE];
+	rope_t rope;
+	buffer_t out;
 
 	if (format == NULL)
 	{
@@ -1285,41 +2244,88 @@ int wlibc_vasprintf(char **restrict buffer, const char *restrict format, va_list
 		return -1;
 	}
 
+	rope_init(&out, &rope, initial, PRINT_CHUNK_SIZE);
 	result = wlibc_printf_internal(&out, format, args);
-	*buffer = (void *)out.data;
+
+	if (result == -1 || out.error)
+	{
+		rope_free(&out);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	*buffer = rope_linearize(&out);
+
+	if (*buffer == NULL)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
 
 	return result;
 }
 
-int wlibc_vsnprintf(char *restrict buffer, size_t size, const char *restrict format, va_list args)
+static int common_vsnprintf(char *restrict buffer, size_t size, const char *restrict format, const printf_program *restrict program,
+							va_list args)
 {
 	int result = 0;
 
-	if (format == NULL)
+	if (buffer != NULL && size == 0)
 	{
 		errno = EINVAL;
 		return -1;
 	}
 
-	if (buffer != NULL && size == 0)
+	result = print_dispatch(&(buffer_t){.data = (void *)buffer, .size = size}, format, program, args);
+
+	if (result < (int)size)
+	{
+		buffer[result] = '\0';
+	}
+
+	return result;
+}
+
+int wlibc_vsnprintf(char *restrict buffer, size_t size, const char *restrict format, va_list args)
+{
+	if (format == NULL)
 	{
 		errno = EINVAL;
 		return -1;
 	}
 
-	result = wlibc_printf_internal(&(buffer_t){.data = (void *)buffer, .size = size}, format, args);
+	return common_vsnprintf(buffer, size, format, NULL, args);
+}
 
-	if (result < (int)size)
+int wlibc_vsnprintf_compiled(char *restrict buffer, size_t size, const printf_program *restrict program, va_list args)
+{
+	if (program == NULL)
 	{
-		buffer[result] = '\0';
+		errno = EINVAL;
+		return -1;
 	}
 
-	return result;
+	return common_vsnprintf(buffer, size, NULL, program, args);
+}
+
+static int print_copy_segment(void *context, const void *data, size_t size)
+{
+	char **out = (char **)context;
+
+	memcpy(*out, data, size);
+	*out += size;
+
+	return 0;
 }
 
 char *wlibc_vasnprintf(char *restrict buffer, size_t *size, const char *restrict format, va_list args)
 {
-	buffer_t out = {.write = memory_buffer_write};
+	int result = 0;
+	uint8_t initial[PRINT_CHUNK_SIZE];
+	rope_t rope;
+	buffer_t out;
+	size_t length = 0;
+	char *end = NULL;
 
 	if (format == NULL)
 	{
@@ -1339,21 +2345,39 @@ char *wlibc_vasnprintf(char *restrict buffer, size_t *size, const char *restrict
 		return NULL;
 	}
 
-	*size = wlibc_printf_internal(&out, format, args);
+	rope_init(&out, &rope, initial, PRINT_CHUNK_SIZE);
+	result = wlibc_printf_internal(&out, format, args);
 
-	if (out.size <= *size)
+	if (result == -1 || out.error)
 	{
-		memset(buffer, 0, *size);
-		memcpy(buffer, out.data, out.size);
-		free(out.data);
+		rope_free(&out);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	length = rope_length(&out);
+
+	// Use the given buffer if the output fits.
+	if (buffer != NULL && length < *size)
+	{
+		end = buffer;
+		rope_gather(&out, print_copy_segment, &end);
+		rope_free(&out);
 
-		*size = out.size;
+		buffer[length] = '\0';
+	}
+	else
+	{
+		buffer = rope_linearize(&out);
 
-		return buffer;
+		if (buffer == NULL)
+		{
+			errno = ENOMEM;
+			return NULL;
+		}
 	}
 
-	*size = out.size;
-	buffer = (void *)out.data;
+	*size = length;
 
 	return buffer;
 }
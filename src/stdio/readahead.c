@@ -0,0 +1,253 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#include <internal/nt.h>
+#include <internal/error.h>
+#include <internal/fcntl.h>
+#include <internal/stdio.h>
+#include <internal/minmax.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#define READAHEAD_THRESHOLD 2 // consecutive reads without a seek
+
+struct _stream_readahead
+{
+	HANDLE handle; // asynchronous handle to the same file
+	IO_STATUS_BLOCK io;
+	NTSTATUS status; // of the request in flight
+	char *buffer;
+	size_t size;
+	size_t filled;
+	size_t consumed;
+	size_t position; // file offset of the next read, the fd lags behind it while active
+	unsigned int sequential;
+	BOOLEAN active;
+	BOOLEAN pending;
+};
+
+static ssize_t readahead_complete(stream_readahead *readahead, NTSTATUS status)
+{
+	if (status == STATUS_PENDING)
+	{
+		NtWaitForSingleObject(readahead->handle, FALSE, NULL);
+		status = readahead->io.Status;
+	}
+
+	if (status == STATUS_SUCCESS)
+	{
+		return readahead->io.Information;
+	}
+
+	if (status == STATUS_END_OF_FILE)
+	{
+		return 0;
+	}
+
+	map_ntstatus_to_errno(status);
+	return -1;
+}
+
+static void readahead_submit(stream_readahead *readahead)
+{
+	LARGE_INTEGER offset;
+
+	offset.QuadPart = readahead->position;
+
+	readahead->filled = 0;
+	readahead->consumed = 0;
+	readahead->status =
+		NtReadFile(readahead->handle, NULL, NULL, NULL, &readahead->io, readahead->buffer, (ULONG)readahead->size, &offset, NULL);
+
+	// An immediate failure (end of file) is reported again by the next synchronous read.
+	readahead->pending = (readahead->status == STATUS_PENDING || readahead->status == STATUS_SUCCESS);
+}
+
+static int readahead_activate(FILE *stream, stream_readahead *readahead)
+{
+	if (readahead->handle == NULL)
+	{
+		// The stream's handle is synchronous, overlapped requests need a handle of their own.
+		readahead->handle = just_reopen(get_fd_handle(stream->fd), FILE_READ_DATA | SYNCHRONIZE, 0);
+
+		if (readahead->handle == NULL)
+		{
+			return -1;
+		}
+	}
+
+	if (readahead->buffer == NULL)
+	{
+		readahead->buffer = (char *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, stream->buf_size);
+
+		if (readahead->buffer == NULL)
+		{
+			return -1;
+		}
+
+		readahead->size = stream->buf_size;
+	}
+
+	// The buffers are swapped, so keep their sizes the same from now on.
+	stream->base_size = 0;
+
+	readahead->position = lseek(stream->fd, 0, SEEK_CUR);
+	readahead->active = 1;
+
+	readahead_submit(readahead);
+
+	return 0;
+}
+
+ssize_t readahead_read(FILE *stream, void *buffer, size_t size)
+{
+	stream_readahead *readahead = stream->readahead;
+	ssize_t result = 0;
+
+	if (readahead == NULL)
+	{
+		readahead = (stream_readahead *)RtlAllocateHeap(NtCurrentProcessHeap(), HEAP_ZERO_MEMORY, sizeof(stream_readahead));
+
+		if (readahead == NULL)
+		{
+			stream->buf_mode &= ~_IOBUFFER_READAHEAD;
+			return read(stream->fd, buffer, size);
+		}
+
+		stream->readahead = readahead;
+	}
+
+	if (readahead->active == 0)
+	{
+		// Plain reads keep the fd in sync, until the access is seen to be sequential.
+		result = read(stream->fd, buffer, size);
+
+		if (result > 0 && ++readahead->sequential >= READAHEAD_THRESHOLD)
+		{
+			if (readahead_activate(stream, readahead) == -1)
+			{
+				// Do not try again.
+				readahead_free(stream);
+				stream->buf_mode &= ~_IOBUFFER_READAHEAD;
+			}
+		}
+
+		return result;
+	}
+
+	if (readahead->pending)
+	{
+		readahead->pending = 0;
+		result = readahead_complete(readahead, readahead->status);
+
+		if (result == -1)
+		{
+			return -1;
+		}
+
+		readahead->filled = result;
+	}
+
+	if (readahead->consumed < readahead->filled)
+	{
+		if (buffer == stream->buffer && size == readahead->size && readahead->consumed == 0 &&
+			(stream->buf_mode & (_IOBUFFER_INTERNAL | _IOBUFFER_ALLOCATED)) == (_IOBUFFER_INTERNAL | _IOBUFFER_ALLOCATED))
+		{
+			// The stream buffer is being refilled, hand over the read ahead buffer instead of copying it.
+			stream->buffer = readahead->buffer;
+			readahead->buffer = buffer;
+			result = readahead->filled;
+		}
+		else
+		{
+			result = MIN(size, readahead->filled - readahead->consumed);
+			memcpy(buffer, readahead->buffer + readahead->consumed, result);
+		}
+
+		readahead->consumed += result;
+	}
+	else
+	{
+		// Nothing was read ahead (end of file), read synchronously.
+		LARGE_INTEGER offset;
+
+		offset.QuadPart = readahead->position;
+		result = readahead_complete(
+			readahead, NtReadFile(readahead->handle, NULL, NULL, NULL, &readahead->io, buffer, (ULONG)size, &offset, NULL));
+
+		if (result <= 0)
+		{
+			return result;
+		}
+	}
+
+	readahead->position += result;
+
+	// Start reading the next block while this one is consumed.
+	if (readahead->consumed == readahead->filled)
+	{
+		readahead_submit(readahead);
+	}
+
+	return result;
+}
+
+void readahead_stop(FILE *stream)
+{
+	stream_readahead *readahead = stream->readahead;
+
+	if (readahead == NULL)
+	{
+		return;
+	}
+
+	if (readahead->pending)
+	{
+		readahead_complete(readahead, readahead->status);
+		readahead->pending = 0;
+	}
+
+	if (readahead->active)
+	{
+		// Bring the fd to where plain reads would have left it.
+		lseek(stream->fd, readahead->position, SEEK_SET);
+		readahead->active = 0;
+	}
+
+	readahead->filled = 0;
+	readahead->consumed = 0;
+	readahead->sequential = 0;
+}
+
+void readahead_free(FILE *stream)
+{
+	stream_readahead *readahead = stream->readahead;
+
+	if (readahead == NULL)
+	{
+		return;
+	}
+
+	if (readahead->pending)
+	{
+		readahead_complete(readahead, readahead->status);
+	}
+
+	if (readahead->handle != NULL)
+	{
+		NtClose(readahead->handle);
+	}
+
+	if (readahead->buffer != NULL)
+	{
+		RtlFreeHeap(NtCurrentProcessHeap(), 0, readahead->buffer);
+	}
+
+	RtlFreeHeap(NtCurrentProcessHeap(), 0, readahead);
+	stream->readahead = NULL;
+}
@@ -5,18 +5,29 @@
    Refer to the LICENSE file at the root directory for details.
 */
 
+#include <internal/buffer.h>
+#include <internal/convert.h>
+#include <internal/fcntl.h>
+#include <internal/stdio.h>
+#include <internal/varargs.h>
+
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <unistd.h>
 
-#include <internal/buffer.h>
-#include <internal/convert.h>
-#include <internal/varargs.h>
+#ifdef _M_AMD64
+#	include <intrin.h>
+#	include <immintrin.h>
+#	pragma intrinsic(_BitScanForward)
+#endif
 
 typedef uint8_t byte_t;
 
+int common_fflush(FILE *stream);
+
 // Flags
 #define SCAN_SUPPRESS_INPUT  0x01 // *
 #define SCAN_ALLOCATE_STRING 0x02 // m
@@ -67,6 +78,18 @@ typedef enum _scan_type
 
 } scan_type;
 
+#define SCAN_SET_MAX_RANGES 4
+
+typedef struct _scan_set
+{
+	uint64_t bits[2]; // only ascii 128 character set
+	uint8_t low[16];  // nibble lookup, a byte is a member if low[byte & 0xF] & high[byte >> 4] is not zero
+	uint8_t high[16];
+	uint8_t ranges;   // number of member ranges, 0 if there are more than SCAN_SET_MAX_RANGES
+	uint8_t from[SCAN_SET_MAX_RANGES];
+	uint8_t to[SCAN_SET_MAX_RANGES];
+} scan_set;
+
 typedef struct _scan_config
 {
 	scan_type type;
@@ -77,7 +100,7 @@ typedef struct _scan_config
 	size_t result;
 	void *data;
 	void *suppress;
-	uint64_t set[2];
+	scan_set set;
 } scan_config;
 
 static void parse_number(buffer_t *format, uint32_t *index)
@@ -100,6 +123,337 @@ static void parse_number(buffer_t *format, uint32_t *index)
 	}
 }
 
+// Scan sets are compiled once per format and cached by the address of the set in the format string.
+#define SCAN_SET_CACHE_SIZE 64
+#define SCAN_SET_TEXT_SIZE  48
+
+typedef struct _scan_set_entry
+{
+	const char *format;
+	uint32_t length;
+	char text[SCAN_SET_TEXT_SIZE];
+	scan_set set;
+} scan_set_entry;
+
+static scan_set_entry scan_set_cache[SCAN_SET_CACHE_SIZE];
+static RTL_SRWLOCK scan_set_srwlock;
+
+static scan_set_entry *scan_set_cache_find(const char *format)
+{
+	uintptr_t hash = (uintptr_t)format;
+
+	hash ^= hash >> 6;
+	hash ^= hash >> 12;
+
+	return &scan_set_cache[hash % SCAN_SET_CACHE_SIZE];
+}
+
+static void scan_set_compile(scan_set *set)
+{
+	uint16_t columns[8] = {0};
+	uint16_t classes[8] = {0};
+	uint8_t count = 0;
+	uint8_t member = 0;
+
+	// NUL always ends the input.
+	UNSET_BIT(set->bits, 0);
+
+	memset(set->low, 0, 16);
+	memset(set->high, 0, 16);
+
+	// Group the high nibbles by the low nibbles they accept, there are atmost 8 such groups.
+	for (uint32_t i = 0; i < 128; ++i)
+	{
+		if (GET_BIT(set->bits, i))
+		{
+			columns[i >> 4] |= (uint16_t)(1u << (i & 0xF));
+		}
+	}
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		uint8_t j = 0;
+
+		if (columns[i] == 0)
+		{
+			continue;
+		}
+
+		for (j = 0; j < count; ++j)
+		{
+			if (classes[j] == columns[i])
+			{
+				break;
+			}
+		}
+
+		if (j == count)
+		{
+			classes[count++] = columns[i];
+		}
+
+		set->high[i] = (uint8_t)(1u << j);
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		for (uint32_t j = 0; j < 16; ++j)
+		{
+			if (classes[i] & (1u << j))
+			{
+				set->low[j] |= (uint8_t)(1u << i);
+			}
+		}
+	}
+
+	// Member ranges, for matching with plain compares.
+	set->ranges = 0;
+
+	for (uint32_t i = 0; i < 128; ++i)
+	{
+		if (GET_BIT(set->bits, i) == member)
+		{
+			continue;
+		}
+
+		member = !member;
+
+		if (member)
+		{
+			if (set->ranges == SCAN_SET_MAX_RANGES)
+			{
+				set->ranges = 0;
+				return;
+			}
+
+			set->from[set->ranges] = (uint8_t)i;
+			set->to[set->ranges] = 127;
+		}
+		else
+		{
+			set->to[set->ranges++] = (uint8_t)(i - 1);
+		}
+	}
+
+	if (member)
+	{
+		set->ranges++;
+	}
+}
+
+static uint32_t parse_scan_set(buffer_t *format, scan_set *set)
+{
+	const char *start = current(format);
+	scan_set_entry *entry = scan_set_cache_find(start);
+	uint32_t found = 0;
+	size_t length = 0;
+	byte_t first = 0;
+	byte_t exclude = 0;
+	byte_t closed = 0;
+	byte_t byte = 0;
+
+	RtlAcquireSRWLockShared(&scan_set_srwlock);
+
+	if (entry->format == start && strncmp(entry->text, start, entry->length) == 0)
+	{
+		memcpy(set, &entry->set, sizeof(scan_set));
+		length = entry->length;
+		found = 1;
+	}
+
+	RtlReleaseSRWLockShared(&scan_set_srwlock);
+
+	if (found)
+	{
+		// The format is read lazily, the matched text may extend past the current window.
+		fill(format, length);
+		advance(format, length);
+		return 1;
+	}
+
+	while ((byte = peekbyte(format, 0)) != '\0')
+	{
+		if (first == 0)
+		{
+			first = 1;
+
+			if (byte == ']')
+			{
+				SET_BIT(set->bits, byte);
+
+				readbyte(format);
+				continue;
+			}
+
+			if (byte == '^')
+			{
+				exclude = 1;
+				set->bits[0] = 0xFFFFFFFFFFFFFFFF;
+				set->bits[1] = 0xFFFFFFFFFFFFFFFF;
+
+				// check to see if next byte is ']'
+				if (peekbyte(format, 1) == ']')
+				{
+					UNSET_BIT(set->bits, ']');
+					readbyte(format);
+				}
+
+				readbyte(format);
+				continue;
+			}
+		}
+
+		if (byte == ']')
+		{
+			closed = 1;
+			readbyte(format);
+
+			break;
+		}
+
+		// only ascii 128 character set
+		if (byte < 128)
+		{
+			if (peekbyte(format, 1) == '-')
+			{
+				byte_t from = byte;
+				byte_t to = peekbyte(format, 2);
+
+				if (to != ']')
+				{
+					to = MIN(to, 127);
+
+					while (from <= to)
+					{
+						if (exclude)
+						{
+							UNSET_BIT(set->bits, from);
+						}
+						else
+						{
+							SET_BIT(set->bits, from);
+						}
+
+						++from;
+					}
+
+					advance(format, 3);
+					continue;
+				}
+			}
+
+			if (exclude)
+			{
+				UNSET_BIT(set->bits, byte);
+			}
+			else
+			{
+				SET_BIT(set->bits, byte);
+			}
+		}
+
+		readbyte(format);
+	}
+
+	if (!closed)
+	{
+		return 0;
+	}
+
+	scan_set_compile(set);
+
+	length = (const char *)current(format) - start;
+
+	if (length <= SCAN_SET_TEXT_SIZE)
+	{
+		RtlAcquireSRWLockExclusive(&scan_set_srwlock);
+
+		entry->format = start;
+		entry->length = (uint32_t)length;
+		memcpy(entry->text, start, length);
+		memcpy(&entry->set, set, sizeof(scan_set));
+
+		RtlReleaseSRWLockExclusive(&scan_set_srwlock);
+	}
+
+	return 1;
+}
+
+// Number of bytes from the start that are members of the set.
+static size_t scan_set_span(const scan_set *set, const uint8_t *data, size_t size)
+{
+	size_t count = 0;
+
+#ifdef _M_AMD64
+	unsigned long index = 0;
+	uint32_t mask = 0;
+
+#	ifdef __AVX2__
+	{
+		const __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->low));
+		const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->high));
+		const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+		while (size - count >= 32)
+		{
+			__m256i chunk = _mm256_loadu_si256((const __m256i *)(data + count));
+			__m256i lo = _mm256_shuffle_epi8(low, _mm256_and_si256(chunk, nibble));
+			__m256i hi = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble));
+
+			// Bytes above 127 have an empty high nibble entry.
+			mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256()));
+
+			if (mask != 0)
+			{
+				_BitScanForward(&index, mask);
+				return count + index;
+			}
+
+			count += 32;
+		}
+	}
+#	endif
+
+	if (set->ranges != 0)
+	{
+		while (size - count >= 16)
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i *)(data + count));
+			__m128i match = _mm_setzero_si128();
+
+			// Unsigned range compare (x - from <= to - from).
+			for (uint32_t i = 0; i < set->ranges; ++i)
+			{
+				__m128i offset = _mm_sub_epi8(chunk, _mm_set1_epi8((char)set->from[i]));
+				__m128i range = _mm_set1_epi8((char)(set->to[i] - set->from[i]));
+
+				match = _mm_or_si128(match, _mm_cmpeq_epi8(_mm_min_epu8(offset, range), offset));
+			}
+
+			mask = (uint32_t)_mm_movemask_epi8(match) ^ 0xFFFF;
+
+			if (mask != 0)
+			{
+				_BitScanForward(&index, mask);
+				return count + index;
+			}
+
+			count += 16;
+		}
+	}
+#endif
+
+	for (; count < size; ++count)
+	{
+		if (data[count] > 127 || !GET_BIT(set->bits, data[count]))
+		{
+			break;
+		}
+	}
+
+	return count;
+}
+
 static void parse_scan_specifier(buffer_t *format, scan_config *config, variadic_args *args)
 {
 	uint32_t index = 0;
@@ -283,95 +637,9 @@ static void parse_scan_specifier(buffer_t *format, scan_config *config, variadic
 	// parse the set
 	if (config->type == SCAN_SET)
 	{
-		byte_t first = 0;
-		byte_t exclude = 0;
-		byte_t closed = 0;
-
-		while ((byte = peekbyte(format, 0)) != '\0')
-		{
-			if (first == 0)
-			{
-				first = 1;
-
-				if (byte == ']')
-				{
-					SET_BIT(config->set, byte);
-
-					readbyte(format);
-					continue;
-				}
-
-				if (byte == '^')
-				{
-					exclude = 1;
-					config->set[0] = 0xFFFFFFFFFFFFFFFF;
-					config->set[1] = 0xFFFFFFFFFFFFFFFF;
-
-					// check to see if next byte is ']'
-					if (peekbyte(format, 1) == ']')
-					{
-						UNSET_BIT(config->set, ']');
-						readbyte(format);
-					}
-
-					readbyte(format);
-					continue;
-				}
-			}
-
-			if (byte == ']')
-			{
-				closed = 1;
-				readbyte(format);
-
-				break;
-			}
-
-			// only ascii 128 character set
-			if (byte < 128)
-			{
-				if (peekbyte(format, 1) == '-')
-				{
-					byte_t from = byte;
-					byte_t to = peekbyte(format, 2);
-
-					if (to != ']')
-					{
-						while (from <= to)
-						{
-							if (exclude)
-							{
-								UNSET_BIT(config->set, from);
-							}
-							else
-							{
-								SET_BIT(config->set, from);
-							}
-
-							++from;
-						}
-
-						advance(format, 3);
-						continue;
-					}
-				}
-
-				if (exclude)
-				{
-					UNSET_BIT(config->set, byte);
-				}
-				else
-				{
-					SET_BIT(config->set, byte);
-				}
-			}
-
-			readbyte(format);
-		}
-
-		// set to unknown on invalid parse
-		if (!closed)
+		if (parse_scan_set(format, &config->set) == 0)
 		{
+			// set to unknown on invalid parse
 			config->type = SCAN_UNKNOWN;
 		}
 	}
@@ -384,7 +652,7 @@ static void parse_scan_specifier(buffer_t *format, scan_config *config, variadic
 		}
 		else
 		{
-			config->data = variadic_args_get(args, config->index);
+			config->data = variadic_args_get(args, config->index, VARIADIC_ARG_POINTER);
 		}
 	}
 }
@@ -410,6 +678,14 @@ static uint32_t consume_whitespaces(buffer_t *buffer)
 	return count;
 }
 
+static uint32_t scan_utf8(buffer_t *buffer, uint32_t *codepoint)
+{
+	// Refilling a stream window can move the data, take the position only after it.
+	size_t available = fill(buffer, 4);
+
+	return utf8_decode(current(buffer), (uint8_t)MIN(available, 4), codepoint);
+}
+
 static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 {
 	uint32_t result = 0;
@@ -662,7 +938,7 @@ static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 	{
 		uint32_t codepoint = 0;
 
-		if (pending(buffer) == 0)
+		if (fill(buffer, 1) == 0)
 		{
 			return 0;
 		}
@@ -678,7 +954,7 @@ static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 			byte_t data[8] = {0};
 			uint32_t count = 0;
 
-			result = utf8_decode(current(buffer), (uint8_t)pending(buffer), &codepoint);
+			result = scan_utf8(buffer, &codepoint);
 			advance(buffer, result);
 
 			if (result != 0)
@@ -696,7 +972,7 @@ static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 		break;
 		case SCAN_MOD_LONG_LONG:
 		{
-			result = utf8_decode(current(buffer), (uint8_t)pending(buffer), &codepoint);
+			result = scan_utf8(buffer, &codepoint);
 			advance(buffer, result);
 
 			if (result != 0)
@@ -764,7 +1040,7 @@ static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 				break;
 			case SCAN_MOD_LONG:
 			{
-				count = utf8_decode(current(buffer), (uint8_t)pending(buffer), &codepoint);
+				count = scan_utf8(buffer, &codepoint);
 				advance(buffer, count);
 				result += count;
 
@@ -779,7 +1055,7 @@ static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 			break;
 			case SCAN_MOD_LONG_LONG:
 			{
-				count = utf8_decode(current(buffer), (uint8_t)pending(buffer), &codepoint);
+				count = scan_utf8(buffer, &codepoint);
 				advance(buffer, count);
 				result += count;
 
@@ -831,7 +1107,7 @@ static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 
 	if (config->type == SCAN_SET)
 	{
-		byte_t byte = 0;
+		size_t available = 0;
 		buffer_t out = {0};
 
 		if ((config->flags & SCAN_ALLOCATE_STRING) == 0)
@@ -844,61 +1120,53 @@ static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 			out.write = memory_buffer_write;
 		}
 
-		if (config->flags & SCAN_SUPPRESS_INPUT)
+		while ((available = fill(buffer, 1)) != 0)
 		{
-			while ((byte = peekbyte(buffer, 0)) != '\0')
+			byte_t *data = current(buffer);
+			size_t count = scan_set_span(&config->set, data, available);
+
+			if ((config->flags & SCAN_SUPPRESS_INPUT) == 0)
 			{
-				if (byte > 127)
+				switch (config->modifier)
 				{
+				case SCAN_MOD_NONE:
+					writen(&out, data, count);
 					break;
-				}
-
-				if (!GET_BIT(config->set, byte))
-				{
+				case SCAN_MOD_LONG:
+					for (size_t i = 0; i < count; ++i)
+					{
+						writebyte(&out, data[i]);
+						writebyte(&out, 0);
+					}
+					break;
+				case SCAN_MOD_LONG_LONG:
+					for (size_t i = 0; i < count; ++i)
+					{
+						writebyte(&out, data[i]);
+						writebyte(&out, 0);
+						writebyte(&out, 0);
+						writebyte(&out, 0);
+					}
+					break;
+				default:
+					writen(&out, data, count);
 					break;
 				}
-
-				readbyte(buffer);
-				result += 1;
 			}
 
-			goto set_end;
-		}
+			advance(buffer, count);
+			result += (uint32_t)count;
 
-		while ((byte = peekbyte(buffer, 0)) != '\0')
-		{
-			if (byte > 127)
+			// Stopped at a byte not in the set.
+			if (count != available)
 			{
 				break;
 			}
+		}
 
-			if (!GET_BIT(config->set, byte))
-			{
-				break;
-			}
-
-			switch (config->modifier)
-			{
-			case SCAN_MOD_NONE:
-				writebyte(&out, byte);
-				break;
-			case SCAN_MOD_LONG:
-				writebyte(&out, byte);
-				writebyte(&out, 0);
-				break;
-			case SCAN_MOD_LONG_LONG:
-				writebyte(&out, byte);
-				writebyte(&out, 0);
-				writebyte(&out, 0);
-				writebyte(&out, 0);
-				break;
-			default:
-				writebyte(&out, byte);
-				break;
-			}
-
-			result += 1;
-			readbyte(buffer);
+		if (config->flags & SCAN_SUPPRESS_INPUT)
+		{
+			goto set_end;
 		}
 
 		switch (config->modifier)
@@ -975,10 +1243,86 @@ static uint32_t do_scan(buffer_t *buffer, scan_config *config)
 	return 0;
 }
 
+typedef struct _scan_stream
+{
+	FILE *stream;
+	size_t base;     // stream position of the start of the window
+	size_t end;      // data in the window
+	size_t limit;    // end of the current field (field width), SIZE_MAX otherwise
+	size_t capacity; // size of the window
+	uint32_t eof;
+	byte_t local[64]; // window for unbuffered streams
+} scan_stream;
+
+static size_t scan_stream_read(buffer_t *buffer, size_t size)
+{
+	scan_stream *scan = buffer->ctx;
+	FILE *stream = scan->stream;
+	ssize_t result = 0;
+
+	if (scan->limit != SIZE_MAX)
+	{
+		size = MIN(size, scan->limit - buffer->pos);
+	}
+
+	if ((scan->end - buffer->pos) < size && scan->eof == 0)
+	{
+		// Move the unconsumed lookahead to the start of the window.
+		if ((buffer->pos + size) > scan->capacity && buffer->pos != 0)
+		{
+			memmove(buffer->data, buffer->data + buffer->pos, scan->end - buffer->pos);
+
+			scan->base += buffer->pos;
+			scan->end -= buffer->pos;
+
+			if (scan->limit != SIZE_MAX)
+			{
+				scan->limit -= buffer->pos;
+			}
+
+			buffer->pos = 0;
+		}
+
+		while ((scan->end - buffer->pos) < size && scan->end < scan->capacity)
+		{
+			// Read only what is needed for unbuffered streams, there is no way to give it back.
+			if (stream->buf_mode & _IONBF)
+			{
+				result = read(stream->fd, buffer->data + scan->end, size - (scan->end - buffer->pos));
+			}
+			else
+			{
+				result = read(stream->fd, buffer->data + scan->end, scan->capacity - scan->end);
+			}
+
+			if (result == 0)
+			{
+				scan->eof = 1;
+				break;
+			}
+
+			if (result == -1)
+			{
+				stream->error = _IOERROR;
+				buffer->error = 1;
+				break;
+			}
+
+			scan->end += result;
+		}
+	}
+
+	buffer->size = MIN(scan->end, scan->limit);
+
+	return buffer->size - buffer->pos;
+}
+
 static uint32_t scan_arg(buffer_t *buffer, scan_config *config)
 {
 	uint32_t result = 0;
+	uint32_t count = 0;
 	size_t old_size = 0;
+	size_t (*old_read)(buffer_t *, size_t) = NULL;
 
 	if (config->type != SCAN_RESULT && config->type != SCAN_CHAR && config->type != SCAN_SET)
 	{
@@ -987,25 +1331,55 @@ static uint32_t scan_arg(buffer_t *buffer, scan_config *config)
 
 	if (config->width > 0)
 	{
+		if (buffer->read == scan_stream_read)
+		{
+			// Refills stop at the end of the field.
+			((scan_stream *)buffer->ctx)->limit = buffer->pos + config->width;
+		}
+		else
+		{
+			// Make the whole field available and keep it fixed while scanning.
+			fill(buffer, config->width);
+			old_read = buffer->read;
+			buffer->read = NULL;
+		}
+
 		old_size = buffer->size;
-		buffer->size = buffer->pos + config->width;
+		buffer->size = MIN(buffer->pos + config->width, buffer->size);
 	}
 
-	result += do_scan(buffer, config);
+	count = do_scan(buffer, config);
 
 	if (config->width > 0)
 	{
-		buffer->size = old_size;
+		if (buffer->read == scan_stream_read)
+		{
+			scan_stream *scan = buffer->ctx;
+
+			scan->limit = SIZE_MAX;
+			buffer->size = scan->end;
+		}
+		else
+		{
+			buffer->read = old_read;
+			buffer->size = old_size;
+		}
+	}
+
+	// Leading whitespace does not count as a match.
+	if (count == 0)
+	{
+		return 0;
 	}
 
-	return result;
+	return result + count;
 }
 
 static int wlibc_scanf_internal(buffer_t *buffer, const char *format, va_list list)
 {
-	variadic_args args = {0};
+	variadic_args args;
 	scan_config config = {0};
-	buffer_t in = {.data = (void *)format, .pos = 0, .size = strnlen(format, 65536)};
+	buffer_t in = {.data = (void *)format, .pos = 0, .size = 0, .read = string_buffer_read};
 
 	uint32_t processed = 0;
 	uint32_t result = 0;
@@ -1014,8 +1388,64 @@ static int wlibc_scanf_internal(buffer_t *buffer, const char *format, va_list li
 
 	variadic_args_init(&args, list);
 
-	while ((byte = readbyte(&in)) != '\0')
+	while (fill(&in, 1) != 0)
 	{
+		// Match the literal run upto the next '%' or whitespace at once.
+		count = literal_span(&in, 1);
+
+		if (count != 0)
+		{
+			size_t matched = 0;
+
+			// Streams may hold only part of the run at a time.
+			while (matched < count)
+			{
+				size_t limit = MIN(count - matched, fill(buffer, count - matched));
+				size_t part = 0;
+
+				if (limit == 0)
+				{
+					break;
+				}
+
+				if (memcmp((byte_t *)current(&in) + matched, current(buffer), limit) == 0)
+				{
+					part = limit;
+				}
+				else
+				{
+					while (part < limit && ((byte_t *)current(&in))[matched + part] == ((byte_t *)current(buffer))[part])
+					{
+						++part;
+					}
+				}
+
+				advance(buffer, part);
+				matched += part;
+
+				if (part != limit)
+				{
+					break;
+				}
+			}
+
+			advance(&in, matched);
+			processed += (uint32_t)matched;
+
+			if (matched != count)
+			{
+				break;
+			}
+		}
+
+		// The run continues in the next chunk.
+		if (pending(&in) == 0)
+		{
+			continue;
+		}
+
+		byte = readbyte(&in);
+
 		if (byte == '%')
 		{
 			byte = peekbyte(&in, 0);
@@ -1072,21 +1502,9 @@ static int wlibc_scanf_internal(buffer_t *buffer, const char *format, va_list li
 
 			continue;
 		}
-		else
+		else if (IS_SPACE(byte))
 		{
-			if (IS_SPACE(byte))
-			{
-				processed += consume_whitespaces(buffer);
-				continue;
-			}
-
-			if (peekbyte(buffer, 0) != byte)
-			{
-				break;
-			}
-
-			readbyte(buffer);
-			processed += 1;
+			processed += consume_whitespaces(buffer);
 		}
 	}
 
@@ -1097,18 +1515,156 @@ static int wlibc_scanf_internal(buffer_t *buffer, const char *format, va_list li
 
 int wlibc_vfscanf(FILE *restrict stream, const char *restrict format, va_list args)
 {
+	int result = 0;
+	scan_stream scan = {0};
+	buffer_t buffer = {0};
+	uint8_t seekable = 1;
+	BOOLEAN locked;
+
 	if (format == NULL)
 	{
 		errno = EINVAL;
 		return -1;
 	}
 
-	if (stream == NULL)
+	VALIDATE_FILE_STREAM(stream, -1);
+
+	LOCK_FILE_STREAM(stream, &locked);
+
+	if (stream->error == _IOEOF || stream->error == _IOERROR)
 	{
-		return -1;
+		UNLOCK_FILE_STREAM(stream, locked);
+		return EOF;
+	}
+
+	// Stream was opened for writing only.
+	if (stream->buf_mode & _IOBUFFER_WRONLY)
+	{
+		errno = EACCES;
+		stream->error = _IOERROR;
+		UNLOCK_FILE_STREAM(stream, locked);
+		return EOF;
+	}
+
+	// Flush the stream if we have written to it previously
+	if (stream->prev_op == OP_WRITE)
+	{
+		common_fflush(stream);
+		stream->end = stream->start;
+	}
+
+	stream->prev_op = OP_READ;
+
+	// The window is refilled from the fd directly.
+	readahead_stop(stream);
+
+	scan.stream = stream;
+	scan.limit = SIZE_MAX;
+
+	if (IS_MEMORY_STREAM(stream))
+	{
+		// Scan the contents in place, there is nothing more to read.
+		memstream_begin(stream, OP_READ);
+
+		scan.base = 0;
+		scan.end = stream->end;
+		scan.capacity = stream->end;
+		scan.eof = 1;
+		buffer.data = (uint8_t *)stream->buffer;
+		buffer.pos = MIN(stream->pos, stream->end);
+		buffer.size = scan.end;
+	}
+	else if (stream->buf_mode & _IONBF)
+	{
+		scan.base = stream->pos;
+		scan.capacity = sizeof(scan.local);
+		buffer.data = scan.local;
+
+		// Lookahead can not be given back to pipes and consoles, keep it to what the stream can hold.
+		if (get_fd_type(stream->fd) != FILE_HANDLE)
+		{
+			seekable = 0;
+			scan.capacity = sizeof(stream->unread);
+		}
+
+		// Start with the lookahead left by the previous call.
+		memcpy(scan.local, stream->unread, stream->unread_count);
+		scan.end = stream->unread_count;
+		buffer.size = scan.end;
+		stream->unread_count = 0;
 	}
+	else
+	{
+		// allocate the buffer if not allocated already
+		if ((stream->buf_mode & _IOBUFFER_INTERNAL) && ((stream->buf_mode & _IOBUFFER_ALLOCATED) == 0))
+		{
+			stream->buffer = (char *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, sizeof(char) * stream->buf_size);
 
-	return wlibc_scanf_internal(&(buffer_t){.data = NULL, .size = 0}, format, args);
+			if (stream->buffer == NULL)
+			{
+				errno = ENOMEM;
+				UNLOCK_FILE_STREAM(stream, locked);
+				return EOF;
+			}
+
+			stream->buf_mode |= _IOBUFFER_ALLOCATED;
+		}
+
+		// Scan directly inside the stream buffer.
+		scan.base = stream->start;
+		scan.end = stream->end - stream->start;
+		scan.capacity = stream->buf_size;
+		buffer.data = (uint8_t *)stream->buffer;
+		buffer.pos = stream->pos - stream->start;
+		buffer.size = scan.end;
+	}
+
+	buffer.ctx = &scan;
+	buffer.read = scan_stream_read;
+
+	result = wlibc_scanf_internal(&buffer, format, args);
+
+	stream->pos = scan.base + buffer.pos;
+
+	if (stream->buf_mode & _IONBF)
+	{
+		stream->start = stream->pos;
+		stream->end = stream->pos;
+
+		// Give back the lookahead.
+		if (buffer.pos != scan.end)
+		{
+			if (seekable)
+			{
+				lseek(stream->fd, -(off_t)(scan.end - buffer.pos), SEEK_CUR);
+			}
+			else
+			{
+				stream->unread_count = scan.end - buffer.pos;
+				memcpy(stream->unread, scan.local + buffer.pos, stream->unread_count);
+			}
+		}
+	}
+	else
+	{
+		stream->start = scan.base;
+		stream->end = scan.base + scan.end;
+	}
+
+	if (scan.eof && buffer.pos == scan.end)
+	{
+		stream->error = _IOEOF;
+
+		// Input failure before the first conversion.
+		if (result == 0)
+		{
+			result = EOF;
+		}
+	}
+
+	UNLOCK_FILE_STREAM(stream, locked);
+
+	return result;
 }
 
 int wlibc_vsscanf(const char *restrict str, const char *restrict format, va_list args)
@@ -1119,5 +1675,5 @@ int wlibc_vsscanf(const char *restrict str, const char *restrict format, va_list
 		return -1;
 	}
 
-	return wlibc_scanf_internal(&(buffer_t){.data = (void *)str, .size = strnlen(str, 65536)}, format, args);
+	return wlibc_scanf_internal(&(buffer_t){.data = (void *)str, .size = 0, .read = string_buffer_read}, format, args);
 }
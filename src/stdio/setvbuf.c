@@ -17,11 +17,24 @@ int common_setvbuf(FILE *restrict stream, char *restrict buffer, int mode, size_
 {
 	int buf_type = stream->buf_mode & (_IOBUFFER_RDONLY | _IOBUFFER_WRONLY | _IOBUFFER_RDWR);
 
+	// Memory streams are their own buffer.
+	if (IS_MEMORY_STREAM(stream))
+	{
+		return 0;
+	}
+
+	// Read ahead swaps buffers of the same size, it cannot be used from now on.
+	readahead_free(stream);
+	stream->buf_mode &= ~_IOBUFFER_READAHEAD;
+
 	// Always seek first
 	lseek(stream->fd, stream->pos, SEEK_SET);
 	stream->start = stream->pos;
 	stream->end = stream->pos;
 
+	// The size is now fixed by the user, do not adapt it.
+	stream->base_size = 0;
+
 	if (mode == _IONBF) // no buffering
 	{
 		stream->buf_mode = _IONBF;
@@ -118,6 +131,8 @@ int common_setvbuf(FILE *restrict stream, char *restrict buffer, int mode, size_
 
 int wlibc_setvbuf(FILE *restrict stream, char *restrict buffer, int mode, size_t size)
 {
+	BOOLEAN locked;
+
 	VALIDATE_FILE_STREAM(stream, -1);
 
 	if (!(mode == _IONBF || mode == _IOFBF || mode == _IOLBF))
@@ -126,10 +141,10 @@ int wlibc_setvbuf(FILE *restrict stream, char *restrict buffer, int mode, size_t
 		return -1;
 	}
 
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	common_fflush(stream);
 	int result = common_setvbuf(stream, buffer, mode, size);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return result;
 }
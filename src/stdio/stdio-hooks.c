@@ -116,7 +116,11 @@ FILE *wlibc_freopen(const char *filename, const char *mode, FILE *old_stream)
 
 	int flags = parse_mode(mode);
 	wchar_t *wpath = mb_to_wc(filename_proper);
-	set_fd_handle(fd, new_handle);
+	if (set_fd_handle(fd, new_handle) == -1)
+	{
+		free(wpath);
+		return NULL;
+	}
 	set_fd_type(fd, FILE_HANDLE);
 	set_fd_flags(fd, flags);
 	set_fd_path(fd, wpath);
@@ -20,8 +20,20 @@ int common_ungetc(int ch, FILE *stream)
 
 	if (stream->pos > stream->start)
 	{
+		if (IS_MEMORY_STREAM(stream))
+		{
+			// Do not modify the caller's memory or the mapping, only the character that was read can be pushed back.
+			if (stream->buffer[stream->pos - 1] != (char)ch)
+			{
+				return EOF;
+			}
+		}
+		else
+		{
+			stream->buffer[stream->pos - 1 - stream->start] = (char)ch;
+		}
+
 		stream->pos--;
-		stream->buffer[stream->pos - stream->start] = (char)ch;
 		// clear eof flag
 		stream->error = stream->error & ~_IOEOF;
 		return ch;
@@ -32,15 +44,17 @@ int common_ungetc(int ch, FILE *stream)
 
 int wlibc_ungetc(int ch, FILE *stream)
 {
+	BOOLEAN locked;
+
 	if(ch == EOF)
 	{
 		return EOF;
 	}
 
 	VALIDATE_FILE_STREAM(stream, EOF);
-	LOCK_FILE_STREAM(stream);
+	LOCK_FILE_STREAM(stream, &locked);
 	int result = common_ungetc(ch, stream);
-	UNLOCK_FILE_STREAM(stream);
+	UNLOCK_FILE_STREAM(stream, locked);
 
 	return result;
 }
@@ -0,0 +1,108 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#include <internal/buffer.h>
+#include <internal/convert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IS_SPACE(x) ((x) == ' ' || ((x) >= '\t' && (x) <= '\r'))
+
+static size_t skip_float_prefix(buffer_t *buffer, uint8_t *hex)
+{
+	uint8_t sign = 0;
+	uint8_t byte = 0;
+
+	while (IS_SPACE(peekbyte(buffer, 0)))
+	{
+		advance(buffer, 1);
+	}
+
+	byte = peekbyte(buffer, 0);
+
+	if (byte == '+' || byte == '-')
+	{
+		sign = 1;
+	}
+
+	*hex = (peekbyte(buffer, sign) == '0' && TO_LOWER(peekbyte(buffer, sign + 1)) == 'x');
+
+	return buffer->pos;
+}
+
+static double common_strtod(buffer_t *buffer, char **restrict end)
+{
+	double value = 0;
+	uint32_t count = 0;
+	size_t pos = 0;
+	uint8_t hex = 0;
+
+	pos = skip_float_prefix(buffer, &hex);
+
+	if (hex)
+	{
+		count = float_from_hex_common(buffer, &value);
+	}
+	else
+	{
+		count = float_from_normal_common(buffer, &value, 0);
+	}
+
+	if (end != NULL)
+	{
+		*end = (char *)(count == 0 ? buffer->data : buffer->data + pos + count);
+	}
+
+	return value;
+}
+
+static float common_strtof(buffer_t *buffer, char **restrict end)
+{
+	float value = 0;
+	uint32_t count = 0;
+	size_t pos = 0;
+	uint8_t hex = 0;
+
+	pos = skip_float_prefix(buffer, &hex);
+
+	if (hex)
+	{
+		count = float32_from_hex(buffer, &value);
+	}
+	else
+	{
+		count = float32_from_normal(buffer, &value, 0);
+	}
+
+	if (end != NULL)
+	{
+		*end = (char *)(count == 0 ? buffer->data : buffer->data + pos + count);
+	}
+
+	return value;
+}
+
+// The string is only bounded as far as it is parsed, instead of measuring it up front.
+double wlibc_strtod(const char *restrict str, char **restrict end)
+{
+	return common_strtod(&(buffer_t){.data = (void *)str, .size = 0, .read = string_buffer_read}, end);
+}
+
+float wlibc_strtof(const char *restrict str, char **restrict end)
+{
+	return common_strtof(&(buffer_t){.data = (void *)str, .size = 0, .read = string_buffer_read}, end);
+}
+
+double wlibc_strntod(const char *restrict str, size_t length, char **restrict end)
+{
+	return common_strtod(&(buffer_t){.data = (void *)str, .size = strnlen(str, length)}, end);
+}
+
+float wlibc_strntof(const char *restrict str, size_t length, char **restrict end)
+{
+	return common_strtof(&(buffer_t){.data = (void *)str, .size = strnlen(str, length)}, end);
+}
@@ -8,6 +8,7 @@
 #include <internal/nt.h>
 #include <internal/convert.h>
 #include <internal/error.h>
+#include <internal/lock.h>
 #include <internal/sched.h>
 #include <internal/thread.h>
 #include <internal/validate.h>
@@ -76,6 +77,9 @@ int wlibc_thread_create(thread_t *thread, thread_attr_t *attributes, thread_star
 	tinfo->routine = routine;
 	tinfo->args = arg;
 
+	// Stop eliding locks before the thread exists.
+	mark_threads_active();
+
 	thread_handle =
 		CreateRemoteThreadEx(NtCurrentProcess(), NULL, stacksize, wlibc_thread_entry, (void *)tinfo, CREATE_SUSPENDED, NULL, &thread_id);
 	if (thread_handle == NULL)
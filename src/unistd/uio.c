@@ -0,0 +1,553 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#include <internal/nt.h>
+#include <internal/error.h>
+#include <internal/fcntl.h>
+#include <internal/minmax.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+
+// NtReadFile and NtWriteFile take a ULONG length.
+#define UIO_CHUNK_SIZE 0x40000000
+
+// Segments are scattered from one buffer up to these sizes, so that they take a single call.
+// For pipes and consoles this also keeps the data in one message.
+#define UIO_FILE_STAGING_SIZE  16384
+#define UIO_PIPE_STAGING_SIZE  65536
+#define UIO_STACK_STAGING_SIZE 4096
+
+// Writes gather only segments up to this size, copying larger ones costs more than the extra call.
+#define UIO_SMALL_SEGMENT_SIZE 512
+
+#define UIO_CURRENT_POSITION ((off_t)-1)
+
+#define RWF_SUPPORTED (RWF_HIPRI | RWF_DSYNC | RWF_SYNC | RWF_APPEND)
+
+static ssize_t iovec_length(const struct iovec *iov, int iovcnt, int *segments)
+{
+	size_t total = 0;
+
+	*segments = 0;
+
+	if (iovcnt < 0 || iovcnt > IOV_MAX)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (iov == NULL && iovcnt != 0)
+	{
+		errno = EFAULT;
+		return -1;
+	}
+
+	for (int i = 0; i < iovcnt; ++i)
+	{
+		if (iov[i].iov_len == 0)
+		{
+			continue;
+		}
+
+		if (iov[i].iov_base == NULL)
+		{
+			errno = EFAULT;
+			return -1;
+		}
+
+		// The total should fit in the return value.
+		if (iov[i].iov_len > (SIZE_MAX >> 1) - total)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+
+		total += iov[i].iov_len;
+		*segments += 1;
+	}
+
+	return (ssize_t)total;
+}
+
+static int validate_uio_handle(fdinfo *info, off_t position)
+{
+	switch (info->type)
+	{
+	case FILE_HANDLE:
+	case NULL_HANDLE:
+		return 0;
+	case CONSOLE_HANDLE:
+	case PIPE_HANDLE:
+		if (position != UIO_CURRENT_POSITION)
+		{
+			errno = ESPIPE;
+			return -1;
+		}
+		return 0;
+	case DIRECTORY_HANDLE:
+		errno = EISDIR;
+		return -1;
+	default:
+		errno = EBADF;
+		return -1;
+	}
+}
+
+static size_t uio_staging_size(fdinfo *info)
+{
+	return info->type == FILE_HANDLE ? UIO_FILE_STAGING_SIZE : UIO_PIPE_STAGING_SIZE;
+}
+
+static void advance_uio_offset(LARGE_INTEGER *offset, size_t count)
+{
+	// The special offsets (file pointer, end of file) are negative.
+	if (offset != NULL && offset->QuadPart >= 0)
+	{
+		offset->QuadPart += count;
+	}
+}
+
+static ssize_t uio_read(HANDLE handle, void *buffer, size_t size, LARGE_INTEGER *offset)
+{
+	NTSTATUS status;
+	IO_STATUS_BLOCK io;
+
+	io.Information = 0;
+
+	// Same as read.
+	status = NtReadFile(handle, NULL, NULL, NULL, &io, buffer, (ULONG)size, offset, NULL);
+	if (status != STATUS_SUCCESS && status != STATUS_PENDING && status != STATUS_END_OF_FILE && status != STATUS_PIPE_BROKEN &&
+		status != STATUS_PIPE_EMPTY)
+	{
+		map_ntstatus_to_errno(status);
+		return -1;
+	}
+
+	return io.Information;
+}
+
+static ssize_t uio_write(HANDLE handle, const void *buffer, size_t size, LARGE_INTEGER *offset)
+{
+	NTSTATUS status;
+	IO_STATUS_BLOCK io;
+
+	status = NtWriteFile(handle, NULL, NULL, NULL, &io, (PVOID)buffer, (ULONG)size, offset, NULL);
+	if (status != STATUS_SUCCESS && status != STATUS_PENDING)
+	{
+		map_ntstatus_to_errno(status);
+		return -1;
+	}
+
+	return io.Information;
+}
+
+// Transfer the segments in order, each with as few calls as possible. Stops at the first short transfer.
+static ssize_t do_uio_segments(fdinfo *info, const struct iovec *iov, int iovcnt, LARGE_INTEGER *offset, int writing)
+{
+	size_t result = 0;
+
+	for (int i = 0; i < iovcnt; ++i)
+	{
+		size_t done = 0;
+
+		while (done < iov[i].iov_len)
+		{
+			size_t length = MIN(iov[i].iov_len - done, UIO_CHUNK_SIZE);
+			ssize_t count = writing ? uio_write(info->handle, (char *)iov[i].iov_base + done, length, offset)
+								  : uio_read(info->handle, (char *)iov[i].iov_base + done, length, offset);
+
+			if (count == -1)
+			{
+				// Report what was transferred before the failure.
+				return (result + done == 0) ? -1 : (ssize_t)(result + done);
+			}
+
+			done += count;
+			advance_uio_offset(offset, count);
+
+			if ((size_t)count < length)
+			{
+				return result + done;
+			}
+		}
+
+		result += done;
+
+		// Another read from a pipe or a console could block with data already read.
+		if (writing == 0 && info->type != FILE_HANDLE && done != 0)
+		{
+			break;
+		}
+	}
+
+	return result;
+}
+
+static ssize_t do_readv(fdinfo *info, const struct iovec *iov, int iovcnt, size_t total, int segments, LARGE_INTEGER *offset)
+{
+	char stack_buffer[UIO_STACK_STAGING_SIZE];
+	char *buffer = stack_buffer;
+	ssize_t result = 0;
+	size_t copied = 0;
+
+	if (segments == 1 || total > uio_staging_size(info))
+	{
+		return do_uio_segments(info, iov, iovcnt, offset, 0);
+	}
+
+	if (total > UIO_STACK_STAGING_SIZE)
+	{
+		buffer = (char *)RtlAllocateHeap(NtCurrentProcessHeap(), 0, total);
+
+		if (buffer == NULL)
+		{
+			return do_uio_segments(info, iov, iovcnt, offset, 0);
+		}
+	}
+
+	result = uio_read(info->handle, buffer, total, offset);
+
+	// Scatter what was read.
+	for (int i = 0; i < iovcnt && result > 0 && copied < (size_t)result; ++i)
+	{
+		size_t count = MIN(iov[i].iov_len, (size_t)result - copied);
+
+		if (count != 0)
+		{
+			memcpy(iov[i].iov_base, buffer + copied, count);
+			copied += count;
+		}
+	}
+
+	if (buffer != stack_buffer)
+	{
+		RtlFreeHeap(NtCurrentProcessHeap(), 0, buffer);
+	}
+
+	return result;
+}
+
+// Write the staged bytes. Returns the count written, -1 on failure.
+static ssize_t flush_uio_staging(fdinfo *info, const char *buffer, size_t staged, LARGE_INTEGER *offset)
+{
+	ssize_t count = 0;
+
+	if (staged == 0)
+	{
+		return 0;
+	}
+
+	count = uio_write(info->handle, buffer, staged, offset);
+
+	if (count != -1)
+	{
+		advance_uio_offset(offset, count);
+	}
+
+	return count;
+}
+
+static ssize_t do_writev(fdinfo *info, const struct iovec *iov, int iovcnt, size_t total, int segments, LARGE_INTEGER *offset)
+{
+	char buffer[UIO_STACK_STAGING_SIZE];
+	size_t result = 0;
+	size_t staged = 0;
+	ssize_t count = 0;
+
+	if (segments == 1)
+	{
+		return do_uio_segments(info, iov, iovcnt, offset, 1);
+	}
+
+	// Small writes are gathered whole, for pipes and consoles this keeps them in one message.
+	if (total <= UIO_STACK_STAGING_SIZE)
+	{
+		for (int i = 0; i < iovcnt; ++i)
+		{
+			if (iov[i].iov_len != 0)
+			{
+				memcpy(buffer + staged, iov[i].iov_base, iov[i].iov_len);
+				staged += iov[i].iov_len;
+			}
+		}
+
+		return uio_write(info->handle, buffer, total, offset);
+	}
+
+	// Otherwise only runs of small segments are gathered, large segments are written in place.
+	for (int i = 0; i < iovcnt; ++i)
+	{
+		if (iov[i].iov_len == 0)
+		{
+			continue;
+		}
+
+		if (iov[i].iov_len <= UIO_SMALL_SEGMENT_SIZE && staged + iov[i].iov_len <= UIO_STACK_STAGING_SIZE)
+		{
+			memcpy(buffer + staged, iov[i].iov_base, iov[i].iov_len);
+			staged += iov[i].iov_len;
+			continue;
+		}
+
+		count = flush_uio_staging(info, buffer, staged, offset);
+
+		if (count == -1)
+		{
+			return result == 0 ? -1 : (ssize_t)result;
+		}
+
+		result += count;
+
+		if ((size_t)count < staged)
+		{
+			return result;
+		}
+
+		staged = 0;
+
+		if (iov[i].iov_len <= UIO_SMALL_SEGMENT_SIZE)
+		{
+			memcpy(buffer, iov[i].iov_base, iov[i].iov_len);
+			staged = iov[i].iov_len;
+			continue;
+		}
+
+		count = do_uio_segments(info, &iov[i], 1, offset, 1);
+
+		if (count == -1)
+		{
+			return result == 0 ? -1 : (ssize_t)result;
+		}
+
+		result += count;
+
+		if ((size_t)count < iov[i].iov_len)
+		{
+			return result;
+		}
+	}
+
+	count = flush_uio_staging(info, buffer, staged, offset);
+
+	if (count == -1)
+	{
+		return result == 0 ? -1 : (ssize_t)result;
+	}
+
+	return result + count;
+}
+
+static ssize_t common_readv(int fd, const struct iovec *iov, int iovcnt, off_t position)
+{
+	ssize_t result = 0;
+	ssize_t total = 0;
+	int segments = 0;
+	NTSTATUS status;
+	IO_STATUS_BLOCK io;
+	LARGE_INTEGER offset;
+	FILE_POSITION_INFORMATION pos_info;
+	fdinfo info;
+
+	total = iovec_length(iov, iovcnt, &segments);
+
+	if (total == -1)
+	{
+		return -1;
+	}
+
+	get_fdinfo(fd, &info);
+
+	if (validate_uio_handle(&info, position) == -1)
+	{
+		return -1;
+	}
+
+	// Nothing is ever read from a null device.
+	if (total == 0 || info.type == NULL_HANDLE)
+	{
+		return 0;
+	}
+
+	if (position == UIO_CURRENT_POSITION)
+	{
+		return do_readv(&info, iov, iovcnt, total, segments, NULL);
+	}
+
+	// Same as pread, the file pointer is not changed.
+	status = NtQueryInformationFile(info.handle, &io, &pos_info, sizeof(FILE_POSITION_INFORMATION), FilePositionInformation);
+	if (status != STATUS_SUCCESS)
+	{
+		map_ntstatus_to_errno(status);
+		return -1;
+	}
+
+	offset.QuadPart = position;
+	result = do_readv(&info, iov, iovcnt, total, segments, &offset);
+
+	status = NtSetInformationFile(info.handle, &io, &pos_info, sizeof(FILE_POSITION_INFORMATION), FilePositionInformation);
+	if (status != STATUS_SUCCESS)
+	{
+		map_ntstatus_to_errno(status);
+		return -1;
+	}
+
+	return result;
+}
+
+static ssize_t common_writev(int fd, const struct iovec *iov, int iovcnt, off_t position, int flags)
+{
+	ssize_t result = 0;
+	ssize_t total = 0;
+	int segments = 0;
+	NTSTATUS status;
+	IO_STATUS_BLOCK io;
+	LARGE_INTEGER offset;
+	FILE_POSITION_INFORMATION pos_info;
+	fdinfo info;
+
+	total = iovec_length(iov, iovcnt, &segments);
+
+	if (total == -1)
+	{
+		return -1;
+	}
+
+	get_fdinfo(fd, &info);
+
+	if (validate_uio_handle(&info, position) == -1)
+	{
+		return -1;
+	}
+
+	// Everything is written to a null device.
+	if (total == 0 || info.type == NULL_HANDLE)
+	{
+		return total;
+	}
+
+	if (flags & RWF_APPEND)
+	{
+		offset.HighPart = -1;
+		offset.LowPart = FILE_WRITE_TO_END_OF_FILE;
+	}
+	else if (position != UIO_CURRENT_POSITION)
+	{
+		offset.QuadPart = position;
+	}
+	else
+	{
+		offset.HighPart = -1;
+		offset.LowPart = (info.flags & O_APPEND) ? FILE_WRITE_TO_END_OF_FILE : FILE_USE_FILE_POINTER_POSITION;
+	}
+
+	if (position == UIO_CURRENT_POSITION)
+	{
+		result = do_writev(&info, iov, iovcnt, total, segments, &offset);
+	}
+	else
+	{
+		// Same as pwrite, the file pointer is not changed.
+		status = NtQueryInformationFile(info.handle, &io, &pos_info, sizeof(FILE_POSITION_INFORMATION), FilePositionInformation);
+		if (status != STATUS_SUCCESS)
+		{
+			map_ntstatus_to_errno(status);
+			return -1;
+		}
+
+		result = do_writev(&info, iov, iovcnt, total, segments, &offset);
+
+		status = NtSetInformationFile(info.handle, &io, &pos_info, sizeof(FILE_POSITION_INFORMATION), FilePositionInformation);
+		if (status != STATUS_SUCCESS)
+		{
+			map_ntstatus_to_errno(status);
+			return -1;
+		}
+	}
+
+	if (result > 0 && (flags & (RWF_DSYNC | RWF_SYNC)) && info.type == FILE_HANDLE)
+	{
+		status = NtFlushBuffersFileEx(info.handle, (flags & RWF_SYNC) ? 0 : FLUSH_FLAGS_FILE_DATA_SYNC_ONLY, NULL, 0, &io);
+		if (status != STATUS_SUCCESS)
+		{
+			map_ntstatus_to_errno(status);
+			return -1;
+		}
+	}
+
+	return result;
+}
+
+ssize_t wlibc_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	return common_readv(fd, iov, iovcnt, UIO_CURRENT_POSITION);
+}
+
+ssize_t wlibc_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	return common_writev(fd, iov, iovcnt, UIO_CURRENT_POSITION, 0);
+}
+
+ssize_t wlibc_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+	if (offset < 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	return common_readv(fd, iov, iovcnt, offset);
+}
+
+ssize_t wlibc_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+	if (offset < 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	return common_writev(fd, iov, iovcnt, offset, 0);
+}
+
+ssize_t wlibc_preadv2(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags)
+{
+	if (flags & ~RWF_SUPPORTED)
+	{
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	// An offset of -1 means the current position.
+	if (offset < UIO_CURRENT_POSITION)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	return common_readv(fd, iov, iovcnt, offset);
+}
+
+ssize_t wlibc_pwritev2(int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags)
+{
+	if (flags & ~RWF_SUPPORTED)
+	{
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	// An offset of -1 means the current position.
+	if (offset < UIO_CURRENT_POSITION)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	return common_writev(fd, iov, iovcnt, offset, flags);
+}
@@ -8,6 +8,7 @@
 #include <tests/test.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -440,6 +441,59 @@ int test_write_buffer_change()
 	return 0;
 }
 
+int test_write_large()
+{
+	int fd;
+	size_t elements_written;
+	ssize_t result;
+	FILE *f;
+	char *buffer, *check;
+	const size_t size = 1048576;
+	const char *filename = "t-fileio-write-large";
+
+	buffer = malloc(size);
+	check = malloc(size + 8);
+	ASSERT_NOTNULL(buffer);
+	ASSERT_NOTNULL(check);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		buffer[i] = (char)(i % 251);
+	}
+
+	f = fopen(filename, "w");
+	ASSERT_NOTNULL(f);
+
+	// Buffered data is written along with the large write.
+	elements_written = fwrite("abcd", 1, 4, f);
+	ASSERT_EQ(elements_written, 4);
+
+	elements_written = fwrite(buffer, 1, size, f);
+	ASSERT_EQ(elements_written, size);
+	ASSERT_EQ(ftell(f), size + 4);
+
+	elements_written = fwrite("wxyz", 1, 4, f);
+	ASSERT_EQ(elements_written, 4);
+	ASSERT_EQ(ftell(f), size + 8);
+
+	ASSERT_SUCCESS(fclose(f));
+
+	fd = open(filename, O_RDONLY);
+	result = read(fd, check, size + 8);
+	ASSERT_EQ(result, size + 8);
+	ASSERT_MEMEQ(check, "abcd", 4);
+	ASSERT_MEMEQ(check + 4, buffer, size);
+	ASSERT_MEMEQ(check + size + 4, "wxyz", 4);
+	ASSERT_SUCCESS(close(fd));
+
+	ASSERT_SUCCESS(unlink(filename));
+
+	free(buffer);
+	free(check);
+
+	return 0;
+}
+
 int test_read_write()
 {
 	int fd, result;
@@ -647,6 +701,75 @@ int test_read_append()
 	return 0;
 }
 
+int test_read_sequential()
+{
+	int fd;
+	size_t elements_read;
+	ssize_t result;
+	FILE *f;
+	char *buffer;
+	char check[1000];
+	const size_t size = 1048576;
+	const char *filename = "t-fileio-read-sequential";
+
+	buffer = malloc(size);
+	ASSERT_NOTNULL(buffer);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		buffer[i] = (char)(i % 251);
+	}
+
+	fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, 0700);
+	result = write(fd, buffer, size);
+	ASSERT_EQ(result, size);
+	ASSERT_SUCCESS(close(fd));
+
+	// 'S' reads the next block in the background.
+	f = fopen(filename, "rS");
+	ASSERT_NOTNULL(f);
+
+	for (size_t i = 0; i < size / 1000; ++i)
+	{
+		elements_read = fread(check, 1, 1000, f);
+		ASSERT_EQ(elements_read, 1000);
+		ASSERT_MEMEQ(check, buffer + (i * 1000), 1000);
+	}
+
+	ASSERT_EQ(ftell(f), (size / 1000) * 1000);
+
+	// Seek backwards and continue.
+	ASSERT_SUCCESS(fseek(f, 100000, SEEK_SET));
+
+	for (size_t i = 0; i < 300; ++i)
+	{
+		elements_read = fread(check, 1, 1000, f);
+		ASSERT_EQ(elements_read, 1000);
+		ASSERT_MEMEQ(check, buffer + 100000 + (i * 1000), 1000);
+	}
+
+	ASSERT_EQ(fgetc(f), (400000 % 251));
+
+	// The fd should be where the stream's buffer ends.
+	ASSERT_SUCCESS(fseek(f, size - 10, SEEK_SET));
+	ASSERT_EQ(fgetc(f), (int)((size - 10) % 251));
+	result = read(fileno(f), check, 1000);
+	ASSERT_EQ(result, 0);
+
+	// Read till the end.
+	elements_read = fread(check, 1, 1000, f);
+	ASSERT_EQ(elements_read, 9);
+	ASSERT_MEMEQ(check, buffer + size - 9, 9);
+	ASSERT_EQ(feof(f), 1);
+
+	ASSERT_SUCCESS(fclose(f));
+	ASSERT_SUCCESS(unlink(filename));
+
+	free(buffer);
+
+	return 0;
+}
+
 #pragma warning(push)
 #pragma warning(disable: 4244) // Truncation loss of data
 
@@ -843,7 +966,18 @@ int test_gets()
 	ASSERT_EQ(ftell(f), 14);
 	ASSERT_EQ(feof(f), 1);
 
+	// Nothing more to read.
+	ASSERT_NULL(fgets(buf, 16, f));
+	ASSERT_EQ(feof(f), 1);
+
 	ASSERT_SUCCESS(fclose(f));
+
+	// Reading a write only stream.
+	f = fopen(filename, "w");
+	ASSERT_NULL(fgets(buf, 16, f));
+	ASSERT_NOTEQ(ferror(f), 0);
+	ASSERT_SUCCESS(fclose(f));
+
 	ASSERT_SUCCESS(unlink(filename));
 
 	return 0;
@@ -860,10 +994,12 @@ void cleanup()
 	remove("t-fileio-write-internal-buffer");
 	remove("t-fileio-write-external-buffer");
 	remove("t-fileio-write-varying-buffer");
+	remove("t-fileio-write-large");
 
 	remove("t-fileio-read-write");
 	remove("t-fileio-read-write-seek");
 	remove("t-fileio-read-append");
+	remove("t-fileio-read-sequential");
 
 	remove("t-fileio-getc");
 	remove("t-fileio-putc");
@@ -887,11 +1023,13 @@ int main()
 	TEST(test_write_small_buffer_internal());
 	TEST(test_write_small_buffer_external());
 	TEST(test_write_buffer_change());
+	TEST(test_write_large());
 
 	// read and write tests
 	TEST(test_read_write());
 	TEST(test_read_write_seek());
 	TEST(test_read_append());
+	TEST(test_read_sequential());
 
 	TEST(test_getc());
 	TEST(test_putc());
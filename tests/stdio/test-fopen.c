@@ -127,11 +127,43 @@ int test_rplus()
 	return 0;
 }
 
+int test_recycle()
+{
+	FILE *f1, *f2;
+	size_t length;
+	const char *filename = "t-fopen-recycle";
+
+	f1 = fopen(filename, "w");
+	ASSERT_NOTNULL(f1);
+
+	length = fwrite("hello", 1, 5, f1);
+	ASSERT_EQ(length, 5);
+	ASSERT_SUCCESS(fclose(f1));
+
+	// Closed streams are reused, make sure nothing of the old stream remains.
+	for (int i = 0; i < 64; ++i)
+	{
+		f2 = fopen(filename, "r");
+		ASSERT_NOTNULL(f2);
+		ASSERT_EQ(ftell(f2), 0);
+		ASSERT_EQ(feof(f2), 0);
+
+		// Also walk the registry with live and free streams in it.
+		ASSERT_SUCCESS(fflush(NULL));
+		ASSERT_SUCCESS(fclose(f2));
+	}
+
+	ASSERT_SUCCESS(unlink(filename));
+
+	return 0;
+}
+
 void cleanup()
 {
 	remove("t-fopen-w+");
 	remove("t-fopen-a+");
 	remove("t-fopen-r+");
+	remove("t-fopen-recycle");
 }
 
 int main()
@@ -143,6 +175,7 @@ int main()
 	TEST(test_wplus());
 	TEST(test_aplus());
 	TEST(test_rplus());
+	TEST(test_recycle());
 
 	VERIFY_RESULT_AND_EXIT();
 }
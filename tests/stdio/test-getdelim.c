@@ -41,10 +41,15 @@ int test_getdelim()
 	ASSERT_EQ(result, 17);
 	ASSERT_STREQ(buffer, "mnopqrstuvwxyz012");
 
+	// No delimiter before the end.
 	result = getdelim(&buffer, &size, 'a', f);
-	ASSERT_EQ(result, -1);
+	ASSERT_EQ(result, 7);
+	ASSERT_STREQ(buffer, "3456789");
 	ASSERT_EQ(feof(f), 1);
 
+	result = getdelim(&buffer, &size, 'a', f);
+	ASSERT_EQ(result, -1);
+
 	free(buffer);
 	ASSERT_SUCCESS(fclose(f));
 	ASSERT_SUCCESS(unlink(filename));
@@ -77,10 +82,130 @@ int test_getline()
 	ASSERT_STREQ(buffer, "klmnopqrstuvwxyz\n");
 
 	result = getline(&buffer, &size, f);
-	ASSERT_EQ(result, -1);
+	ASSERT_EQ(result, 10);
 	ASSERT_EQ(size, 64);
+	ASSERT_STREQ(buffer, "0123456789");
+	ASSERT_EQ(feof(f), 1);
+
+	result = getline(&buffer, &size, f);
+	ASSERT_EQ(result, -1);
+
+	free(buffer);
+	ASSERT_SUCCESS(fclose(f));
+	ASSERT_SUCCESS(unlink(filename));
+
+	return 0;
+}
+
+int test_getline_long()
+{
+	FILE *f;
+	ssize_t result;
+	size_t size = 0;
+	char *buffer = NULL;
+	char *line = (char *)malloc(5000);
+	const char *filename = "t-getline-long";
+
+	// Lines longer than both the stream buffer and the initial allocation.
+	for (int i = 0; i < 5000; ++i)
+	{
+		line[i] = 'a' + (i % 26);
+	}
+
+	line[4999] = '\n';
+
+	f = fopen(filename, "w+");
+	result = fwrite(line, 1, 5000, f);
+	ASSERT_EQ(result, 5000);
+	result = fwrite("abc\n", 1, 4, f);
+	ASSERT_EQ(result, 4);
+	fseek(f, 0, SEEK_SET);
+	ASSERT_EQ(ftell(f), 0);
+
+	result = getline(&buffer, &size, f);
+	ASSERT_EQ(result, 5000);
+	ASSERT_EQ(size, 8192);
+	ASSERT_MEMEQ(buffer, line, 5000);
+	ASSERT_EQ(buffer[5000], '\0');
+	ASSERT_EQ(ftell(f), 5000);
+
+	result = getline(&buffer, &size, f);
+	ASSERT_EQ(result, 4);
+	ASSERT_STREQ(buffer, "abc\n");
+
+	result = getline(&buffer, &size, f);
+	ASSERT_EQ(result, -1);
 	ASSERT_EQ(feof(f), 1);
 
+	free(line);
+	free(buffer);
+	ASSERT_SUCCESS(fclose(f));
+	ASSERT_SUCCESS(unlink(filename));
+
+	return 0;
+}
+
+int test_getline_binary()
+{
+	int fd;
+	FILE *f;
+	ssize_t result;
+	size_t size = 0;
+	char *buffer = NULL;
+	const char *filename = "t-getline-binary";
+
+	fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, 0700);
+	result = write(fd, "ab\xff" "cd\n\xff\xff", 8);
+	ASSERT_EQ(result, 8);
+	ASSERT_SUCCESS(close(fd));
+
+	// 0xFF is data, not EOF. Read it unbuffered as well.
+	for (int i = 0; i < 2; ++i)
+	{
+		f = fopen(filename, "r");
+
+		if (i == 1)
+		{
+			ASSERT_SUCCESS(setvbuf(f, NULL, _IONBF, 0));
+		}
+
+		result = getline(&buffer, &size, f);
+		ASSERT_EQ(result, 6);
+		ASSERT_MEMEQ(buffer, "ab\xff" "cd\n", 7);
+
+		result = getdelim(&buffer, &size, 0xFF, f);
+		ASSERT_EQ(result, 1);
+		ASSERT_MEMEQ(buffer, "\xff", 2);
+
+		result = getdelim(&buffer, &size, 0xFF, f);
+		ASSERT_EQ(result, 1);
+
+		result = getdelim(&buffer, &size, 0xFF, f);
+		ASSERT_EQ(result, -1);
+		ASSERT_EQ(feof(f), 1);
+
+		ASSERT_SUCCESS(fclose(f));
+	}
+
+	free(buffer);
+	ASSERT_SUCCESS(unlink(filename));
+
+	return 0;
+}
+
+int test_getline_error()
+{
+	FILE *f;
+	ssize_t result;
+	size_t size = 0;
+	char *buffer = NULL;
+	const char *filename = "t-getline-error";
+
+	f = fopen(filename, "w");
+	result = getline(&buffer, &size, f);
+	ASSERT_EQ(result, -1);
+	ASSERT_NOTEQ(ferror(f), 0);
+
 	free(buffer);
 	ASSERT_SUCCESS(fclose(f));
 	ASSERT_SUCCESS(unlink(filename));
@@ -92,6 +217,9 @@ void cleanup()
 {
 	remove("t-getdelim");
 	remove("t-getline");
+	remove("t-getline-long");
+	remove("t-getline-binary");
+	remove("t-getline-error");
 }
 
 int main()
@@ -101,6 +229,9 @@ int main()
 
 	TEST(test_getdelim());
 	TEST(test_getline());
+	TEST(test_getline_long());
+	TEST(test_getline_binary());
+	TEST(test_getline_error());
 
 	VERIFY_RESULT_AND_EXIT();
 }
@@ -9,73 +9,78 @@
 #include <tests/test.h>
 #include <stdio.h>
 
+static int count_live_streams()
+{
+	int count = 0;
+
+	for (FILE *list = _wlibc_stdio_head; list != NULL; list = list->next)
+	{
+		if (list->magic == FILE_STREAM_MAGIC)
+		{
+			++count;
+		}
+	}
+
+	return count;
+}
+
 // fclose is also tested here
 int test_list()
 {
 	int result;
-	FILE *f1, *f2, *list;
+	FILE *f1, *f2, *list, *old_stdin;
 	const char *filename1 = "t-list1";
 	const char *filename2 = "t-list2";
 
-	// Check std streams
+	// Check std streams, new streams are added to the front.
 	list = _wlibc_stdio_head;
 	// stderr
 	ASSERT_EQ(list->fd, 2);
-	ASSERT_NULL(list->next);
 
 	// stdout
-	list = list->prev;
+	list = list->next;
 	ASSERT_EQ(list->fd, 1);
-	ASSERT_EQ(list->next->fd, 2);
 
 	// stdin
-	list = list->prev;
+	list = list->next;
 	ASSERT_EQ(list->fd, 0);
-	ASSERT_NULL(list->prev);
-	ASSERT_EQ(list->next->fd, 1);
+	ASSERT_NULL(list->next);
+
+	ASSERT_EQ(count_live_streams(), 3);
 
 	f1 = fopen(filename1, "wD"); // delete automatically when stream is closed
 	ASSERT_NOTNULL(f1);
 
 	// reset
 	list = _wlibc_stdio_head;
+	ASSERT_EQ(list, f1);
 	ASSERT_EQ(list->fd, 3);
-	ASSERT_NULL(list->next);
-	ASSERT_EQ(list->prev->fd, 2);
+	ASSERT_EQ(list->next->fd, 2);
 
+	old_stdin = stdin;
 	ASSERT_SUCCESS(fclose(stdin)); // close first stream
 
-	list = list->prev->prev;
-	ASSERT_EQ(list->fd, 1);
-	ASSERT_NULL(list->prev);
+	// Closed streams stay in the list.
+	ASSERT_EQ(old_stdin->magic, 0);
+	ASSERT_EQ(count_live_streams(), 3);
 
 	f2 = fopen(filename2, "wD"); // delete automatically when stream is closed
 	ASSERT_NOTNULL(f2);
 
-	// reset
-	list = _wlibc_stdio_head;
-	ASSERT_EQ(list->fd, 0); // stdin's fd should be used
-	ASSERT_NULL(list->next);
-	ASSERT_EQ(list->prev->fd, 3);
+	// stdin's stream and fd should be reused.
+	ASSERT_EQ(f2, old_stdin);
+	ASSERT_EQ(f2->fd, 0);
+	ASSERT_EQ(_wlibc_stdio_head, f1);
+	ASSERT_EQ(count_live_streams(), 4);
 
 	ASSERT_SUCCESS(fclose(f2)); // close last stream
-
-	// reset
-	list = _wlibc_stdio_head;
-	ASSERT_EQ(list->fd, 3);
-	ASSERT_NULL(list->next);
-	ASSERT_EQ(list->prev->fd, 2);
+	ASSERT_EQ(count_live_streams(), 3);
 
 	ASSERT_SUCCESS(fclose(stderr)); // close something in the middle
+	ASSERT_EQ(count_live_streams(), 2);
 
-	// reset
-	list = _wlibc_stdio_head;
-	ASSERT_EQ(list->fd, 3);
-	ASSERT_NULL(list->next);
-	ASSERT_EQ(list->prev->fd, 1); // should be stdout
-
-	list = list->prev;
-	ASSERT_NULL(list->prev);
+	// Closed streams are not valid anymore.
+	ASSERT_FAIL(fflush(f2));
 
 	result = fcloseall();
 	ASSERT_EQ(result, 0);
@@ -84,8 +89,7 @@ int test_list()
 	result = fcloseall();
 	ASSERT_EQ(result, 0);
 
-	list = _wlibc_stdio_head;
-	ASSERT_NULL(list);
+	ASSERT_EQ(count_live_streams(), 0);
 
 	// Check whether 'D' works
 	ASSERT_FAIL(remove(filename1));
@@ -0,0 +1,191 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#include <tests/test.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int test_fmemopen_read()
+{
+	int result;
+	int number;
+	double real;
+	char word[8];
+	char buffer[16];
+	char *line = NULL;
+	size_t size = 0;
+	size_t count;
+	FILE *f;
+	const char *content = "hello world\nsecond line\n42 3.5 end";
+
+	f = fmemopen((void *)content, strlen(content), "r");
+	ASSERT_NOTNULL(f);
+	ASSERT_EQ(fileno(f), -1);
+
+	result = fgetc(f);
+	ASSERT_EQ(result, 'h');
+
+	// Only the character that was read can be pushed back.
+	result = ungetc('h', f);
+	ASSERT_EQ(result, 'h');
+	result = ungetc('x', f);
+	ASSERT_EQ(result, EOF);
+
+	result = (int)getline(&line, &size, f);
+	ASSERT_EQ(result, 12);
+	ASSERT_STREQ(line, "hello world\n");
+
+	ASSERT_NOTNULL(fgets(buffer, 16, f));
+	ASSERT_STREQ(buffer, "second line\n");
+
+	result = fscanf(f, "%d %lf %7s", &number, &real, word);
+	ASSERT_EQ(result, 3);
+	ASSERT_EQ(number, 42);
+	ASSERT_EQ((real == 3.5), 1);
+	ASSERT_STREQ(word, "end");
+
+	result = fgetc(f);
+	ASSERT_EQ(result, EOF);
+	ASSERT_EQ(feof(f), 1);
+
+	ASSERT_SUCCESS(fseek(f, 6, SEEK_SET));
+	count = fread(buffer, 1, 5, f);
+	ASSERT_EQ(count, 5);
+	ASSERT_MEMEQ(buffer, "world", 5);
+
+	// Read only stream.
+	count = fwrite("x", 1, 1, f);
+	ASSERT_EQ(count, 0);
+
+	// Cannot seek past the buffer.
+	ASSERT_FAIL(fseek(f, 100, SEEK_SET));
+	ASSERT_ERRNO(EINVAL);
+
+	ASSERT_SUCCESS(fclose(f));
+	free(line);
+
+	return 0;
+}
+
+int test_fmemopen_write()
+{
+	int result;
+	char memory[16];
+	char buffer[16];
+	size_t count;
+	FILE *f;
+
+	memset(memory, 'z', 16);
+
+	f = fmemopen(memory, 16, "w+");
+	ASSERT_NOTNULL(f);
+	ASSERT_EQ(memory[0], '\0');
+
+	result = fprintf(f, "%d-%s", 123, "ab");
+	ASSERT_EQ(result, 6);
+	ASSERT_SUCCESS(fflush(f));
+	ASSERT_STREQ(memory, "123-ab");
+
+	result = fputc('!', f);
+	ASSERT_EQ(result, '!');
+	ASSERT_SUCCESS(fflush(f));
+	ASSERT_STREQ(memory, "123-ab!");
+
+	rewind(f);
+	count = fread(buffer, 1, 16, f);
+	ASSERT_EQ(count, 7);
+	ASSERT_MEMEQ(buffer, "123-ab!", 7);
+
+	// Writes past the buffer fail.
+	count = fwrite("0123456789", 1, 10, f);
+	ASSERT_EQ(count, 9);
+	ASSERT_ERRNO(ENOSPC);
+	ASSERT_NOTEQ(ferror(f), 0);
+	ASSERT_MEMEQ(memory, "123-ab!012345678", 16);
+
+	ASSERT_SUCCESS(fclose(f));
+
+	// Append
+	strcpy(memory, "abc");
+
+	f = fmemopen(memory, 16, "a+");
+	ASSERT_NOTNULL(f);
+	ASSERT_EQ(ftell(f), 3);
+
+	rewind(f);
+	result = fgetc(f);
+	ASSERT_EQ(result, 'a');
+
+	count = fwrite("de", 1, 2, f);
+	ASSERT_EQ(count, 2);
+	ASSERT_EQ(ftell(f), 5);
+
+	ASSERT_SUCCESS(fclose(f));
+	ASSERT_STREQ(memory, "abcde");
+
+	return 0;
+}
+
+int test_open_memstream()
+{
+	char *ptr = NULL;
+	size_t size = 0;
+	size_t length = 0;
+	FILE *f;
+
+	f = open_memstream(&ptr, &size);
+	ASSERT_NOTNULL(f);
+	ASSERT_NOTNULL(ptr);
+	ASSERT_EQ(size, 0);
+
+	for (int i = 0; i < 3000; ++i)
+	{
+		fprintf(f, "%d,", i);
+	}
+
+	ASSERT_SUCCESS(fflush(f));
+	ASSERT_EQ(size, strlen(ptr));
+	ASSERT_MEMEQ(ptr, "0,1,2,", 6);
+
+	length = size;
+
+	for (int i = 0; i < 5000; ++i)
+	{
+		fputc('q', f);
+	}
+	fwrite("tail", 1, 4, f);
+
+	ASSERT_SUCCESS(fflush(f));
+	ASSERT_EQ(size, length + 5004);
+	ASSERT_EQ(strlen(ptr), size);
+	ASSERT_MEMEQ(ptr + size - 4, "tail", 4);
+
+	// Seeking past the end leaves a gap of zeros.
+	ASSERT_SUCCESS(fseek(f, 100000, SEEK_SET));
+	fputc('Z', f);
+
+	ASSERT_SUCCESS(fclose(f));
+	ASSERT_EQ(size, 100001);
+	ASSERT_EQ(ptr[99999], '\0');
+	ASSERT_EQ(ptr[100000], 'Z');
+	ASSERT_EQ(ptr[100001], '\0');
+
+	free(ptr);
+
+	return 0;
+}
+
+int main()
+{
+	INITIAILIZE_TESTS();
+	TEST(test_fmemopen_read());
+	TEST(test_fmemopen_write());
+	TEST(test_open_memstream());
+	VERIFY_RESULT_AND_EXIT();
+}
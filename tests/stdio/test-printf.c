@@ -6,7 +6,11 @@
 */
 
 #include <tests/test.h>
+#include <fcntl.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #pragma warning(push)
 #pragma warning(disable : 4244) // conversion from 'intmax_t' to 'int'
@@ -63,6 +67,11 @@ int test_simple(void)
 	result = snprintf(NULL, 0, "abcd");
 	status += CHECK_RESULT(result, 4);
 
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "{\"level\": \"info\", \"message\": \"%s\", \"count\": %d}", "started", 42);
+	status += CHECK_STRING(buffer, "{\"level\": \"info\", \"message\": \"started\", \"count\": 42}");
+	status += CHECK_RESULT(result, 52);
+
 	return status;
 }
 
@@ -275,6 +284,16 @@ int test_int(void)
 	status += CHECK_STRING(buffer, "  +05,555,555");
 	status += CHECK_RESULT(result, 13);
 
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%'lld", INT64_MIN);
+	status += CHECK_STRING(buffer, "-9,223,372,036,854,775,808");
+	status += CHECK_RESULT(result, 26);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%'llu", UINT64_MAX);
+	status += CHECK_STRING(buffer, "18,446,744,073,709,551,615");
+	status += CHECK_RESULT(result, 26);
+
 	return status;
 }
 
@@ -630,6 +649,146 @@ int test_float(void)
 	status += CHECK_STRING(buffer, "0x1.5ab904p+11");
 	status += CHECK_RESULT(result, 14);
 
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%f", 1.5);
+	status += CHECK_STRING(buffer, "1.500000");
+	status += CHECK_RESULT(result, 8);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%f", -0.0);
+	status += CHECK_STRING(buffer, "-0.000000");
+	status += CHECK_RESULT(result, 9);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.2f", 2.675);
+	status += CHECK_STRING(buffer, "2.67");
+	status += CHECK_RESULT(result, 4);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.0f", 2.5);
+	status += CHECK_STRING(buffer, "2");
+	status += CHECK_RESULT(result, 1);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.0f", 3.5);
+	status += CHECK_STRING(buffer, "4");
+	status += CHECK_RESULT(result, 1);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%#.0f", 3.0);
+	status += CHECK_STRING(buffer, "3.");
+	status += CHECK_RESULT(result, 2);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.3f", 1e-10);
+	status += CHECK_STRING(buffer, "0.000");
+	status += CHECK_RESULT(result, 5);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%f", 1e21);
+	status += CHECK_STRING(buffer, "1000000000000000000000.000000");
+	status += CHECK_RESULT(result, 29);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%10.3f|", 3.14159);
+	status += CHECK_STRING(buffer, "     3.142|");
+	status += CHECK_RESULT(result, 11);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%-10.3f|", 3.14159);
+	status += CHECK_STRING(buffer, "3.142     |");
+	status += CHECK_RESULT(result, 11);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%+010.2f", 3.14159);
+	status += CHECK_STRING(buffer, "+000003.14");
+	status += CHECK_RESULT(result, 10);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%'.2f", 1234567.891);
+	status += CHECK_STRING(buffer, "1,234,567.89");
+	status += CHECK_RESULT(result, 12);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%e", 1.0);
+	status += CHECK_STRING(buffer, "1.000000e+00");
+	status += CHECK_RESULT(result, 12);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%e", 123456.789);
+	status += CHECK_STRING(buffer, "1.234568e+05");
+	status += CHECK_RESULT(result, 12);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.3E", -0.000123456);
+	status += CHECK_STRING(buffer, "-1.235E-04");
+	status += CHECK_RESULT(result, 10);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.0e", 5e-324);
+	status += CHECK_STRING(buffer, "5e-324");
+	status += CHECK_RESULT(result, 6);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.16e", 0.1);
+	status += CHECK_STRING(buffer, "1.0000000000000001e-01");
+	status += CHECK_RESULT(result, 22);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%e", 1e100);
+	status += CHECK_STRING(buffer, "1.000000e+100");
+	status += CHECK_RESULT(result, 13);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%g", 100000.0);
+	status += CHECK_STRING(buffer, "100000");
+	status += CHECK_RESULT(result, 6);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%g", 1000000.0);
+	status += CHECK_STRING(buffer, "1e+06");
+	status += CHECK_RESULT(result, 5);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%g", 0.0001);
+	status += CHECK_STRING(buffer, "0.0001");
+	status += CHECK_RESULT(result, 6);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%g", 0.00001);
+	status += CHECK_STRING(buffer, "1e-05");
+	status += CHECK_RESULT(result, 5);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.3g", 3.14159);
+	status += CHECK_STRING(buffer, "3.14");
+	status += CHECK_RESULT(result, 4);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%#g", 1.5);
+	status += CHECK_STRING(buffer, "1.50000");
+	status += CHECK_RESULT(result, 7);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%.17g", 0.1);
+	status += CHECK_STRING(buffer, "0.10000000000000001");
+	status += CHECK_RESULT(result, 19);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%G", 1e-10);
+	status += CHECK_STRING(buffer, "1E-10");
+	status += CHECK_RESULT(result, 5);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%5F|%-5E|", INFINITY, INFINITY);
+	status += CHECK_STRING(buffer, "  INF|INF  |");
+	status += CHECK_RESULT(result, 12);
+
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%3$.2f %1$s %2$lld %3$.1e", "abc", 1099511627776ll, 3.14159);
+	status += CHECK_STRING(buffer, "3.14 abc 1099511627776 3.1e+00");
+	status += CHECK_RESULT(result, 30);
+
 	return status;
 }
 
@@ -811,6 +970,12 @@ int test_string()
 	status += CHECK_RESULT(result, 16);
 	status += CHECK_RESULT(out, 16);
 
+	// Conversion stops at an unpaired surrogate.
+	memset(buffer, 0, 256);
+	result = snprintf(buffer, 256, "%ls|", u"abcdefghijklmnopqrstuvwxyzé\xD800xyz");
+	status += CHECK_STRING(buffer, "abcdefghijklmnopqrstuvwxyzé|");
+	status += CHECK_RESULT(result, 29);
+
 	return status;
 }
 
@@ -1006,6 +1171,141 @@ int test_error()
 	return status;
 }
 
+int test_stream()
+{
+	FILE *f;
+	int result;
+	int fd;
+	char buffer[256];
+	ssize_t read_result;
+	const char *filename = "t-printf";
+	const char *expected = "The quick brown fox jumps over the lazy dog 1234567890 -3.50\n"
+						   "The quick brown fox jumps over the lazy dog 1234567890 -3.50\n";
+
+	f = fopen(filename, "w");
+	ASSERT_NOTNULL(f);
+
+	// Output larger than the stream buffer is flushed as it is formatted.
+	ASSERT_SUCCESS(setvbuf(f, NULL, _IOFBF, 16));
+
+	result = fprintf(f, "%s %s %s %s %d %.2f\n", "The quick", "brown fox jumps", "over the", "lazy dog", 1234567890, -3.5);
+	ASSERT_EQ(result, 61);
+
+	result = fprintf(f, "The quick brown fox jumps over the lazy dog %d %.2f\n", 1234567890, -3.5);
+	ASSERT_EQ(result, 61);
+
+	ASSERT_SUCCESS(fclose(f));
+
+	fd = open(filename, O_RDONLY);
+	read_result = read(fd, buffer, 256);
+	ASSERT_EQ(read_result, 122);
+	ASSERT_MEMEQ(buffer, expected, 122);
+	ASSERT_SUCCESS(close(fd));
+
+	ASSERT_SUCCESS(unlink(filename));
+
+	return 0;
+}
+
+int test_asprintf()
+{
+	int status = 0;
+
+	int result = 0;
+	char *buffer = NULL;
+	char *large = NULL;
+	size_t size = 0;
+	char local[16];
+
+	result = asprintf(&buffer, "%s %d", "abc", 10);
+	status += CHECK_STRING(buffer, "abc 10");
+	status += CHECK_RESULT(result, 6);
+	free(buffer);
+
+	// Output spanning multiple segments.
+	large = malloc(200000);
+	ASSERT_NOTNULL(large);
+
+	memset(large, 'a', 200000);
+	large[199999] = '\0';
+
+	result = asprintf(&buffer, "%s|%s", large, large);
+	status += CHECK_RESULT(result, 399999);
+	status += CHECK_RESULT((int)strlen(buffer), 399999);
+	status += CHECK_RESULT(buffer[199999], '|');
+	status += CHECK_RESULT(memcmp(buffer, large, 199999), 0);
+	status += CHECK_RESULT(memcmp(buffer + 200000, large, 199999), 0);
+	free(buffer);
+
+	size = 16;
+	buffer = asnprintf(local, &size, "%s %d", "abc", 10);
+	status += CHECK_RESULT(buffer == local, 1);
+	status += CHECK_STRING(buffer, "abc 10");
+	status += CHECK_RESULT((int)size, 6);
+
+	size = 16;
+	buffer = asnprintf(local, &size, "%s", large);
+	status += CHECK_RESULT(buffer != local, 1);
+	status += CHECK_RESULT((int)size, 199999);
+	free(buffer);
+
+	free(large);
+
+	return status;
+}
+
+int test_compiled()
+{
+	int status = 0;
+
+	int result = 0;
+	int count = 0;
+	char buffer[256] = {0};
+	printf_program *program = NULL;
+	const char *format = "%d%% %s %k%-5.*f|%n%2$s%";
+
+	program = printf_compile(format);
+	ASSERT_NOTNULL(program);
+
+	memset(buffer, 0, 256);
+	result = snprintf_compiled(buffer, 256, program, 10, "abc", 2, 1.125, &count);
+	status += CHECK_STRING(buffer, "10% abc %k1.12 |abc%");
+	status += CHECK_RESULT(result, 20);
+	status += CHECK_RESULT(count, 16);
+
+	// Programs can be reused.
+	memset(buffer, 0, 256);
+	result = snprintf_compiled(buffer, 256, program, -1, "", 0, 2.5, &count);
+	status += CHECK_STRING(buffer, "-1%  %k2    |%");
+	status += CHECK_RESULT(result, 14);
+	status += CHECK_RESULT(count, 13);
+
+	printf_free(program);
+
+	program = printf_compile("%2$s %1$s");
+	ASSERT_NOTNULL(program);
+
+	memset(buffer, 0, 256);
+	result = snprintf_compiled(buffer, 256, program, "world", "hello");
+	status += CHECK_STRING(buffer, "hello world");
+	status += CHECK_RESULT(result, 11);
+
+	printf_free(program);
+
+	// Repeated use of the same format goes through the format cache. Short formats are not cached.
+	const char *expected[4] = {"[cache] item 000 of 4", "[cache] item 001 of 4", "[cache] item 002 of 4", "[cache] item 003 of 4"};
+
+	for (int i = 0; i < 4; ++i)
+	{
+		memset(buffer, 0, 256);
+		result = snprintf(buffer, 256, "[%s] item %03d of %d", "cache", i, 4);
+		status += CHECK_STRING(buffer, expected[i]);
+		status += CHECK_RESULT(result, 21);
+	}
+
+	return status;
+}
+
 #pragma warning(pop)
 
 #ifdef __clang__
@@ -1025,6 +1325,9 @@ int main()
 	TEST(test_pointer());
 	TEST(test_result());
 	TEST(test_error());
+	TEST(test_stream());
+	TEST(test_asprintf());
+	TEST(test_compiled());
 
 	VERIFY_RESULT_AND_EXIT();
 }
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #pragma warning(push)
 #pragma warning(disable : 4305) // truncation from 'double' to 'float'
@@ -88,6 +89,27 @@ int test_simple(void)
 	status += CHECK_UVALUE(n, 11);
 	status += CHECK_RESULT(result, 2);
 
+	result = sscanf("{\"level\": \"info\", \"count\": 4}", "{\"level\": \"info\", \"count\": %c}%n", &c1, &n);
+	status += CHECK_UVALUE(c1, '4');
+	status += CHECK_UVALUE(n, 29);
+	status += CHECK_RESULT(result, 1);
+
+	result = sscanf("{\"level\": \"warn\", \"count\": 4}", "{\"level\": \"info\", \"count\": %c}", &c1);
+	status += CHECK_RESULT(result, 0);
+
+	// Inputs longer than 64KB
+	char *large = malloc(100000);
+	memset(large, ' ', 100000);
+	large[99998] = 'x';
+	large[99999] = '\0';
+
+	result = sscanf(large, " %c%n", &c1, &n);
+	status += CHECK_UVALUE(c1, 'x');
+	status += CHECK_UVALUE(n, 99999);
+	status += CHECK_RESULT(result, 1);
+
+	free(large);
+
 	return status;
 }
 
@@ -922,6 +944,29 @@ int test_set(void)
 	status += CHECK_UVALUE(n, 2);
 	status += CHECK_RESULT(result, 1);
 
+	// The scan set crosses the first chunk of the format that is read.
+	char long_format[300] = {0};
+	memset(long_format, ' ', 250);
+	memcpy(long_format + 250, "%[abcdef]%n", 12);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		result = sscanf("abcdefgh", long_format, u8_str, &n);
+		status += CHECK_STRING(u8_str, "abcdef");
+		status += CHECK_UVALUE(n, 6);
+		status += CHECK_RESULT(result, 1);
+
+		result = sscanf("request_handler_for_the_upstream_service_42,rest", "%[a-zA-Z0-9_]%n", u8_str, &n);
+		status += CHECK_STRING(u8_str, "request_handler_for_the_upstream_service_42");
+		status += CHECK_UVALUE(n, 43);
+		status += CHECK_RESULT(result, 1);
+
+		result = sscanf("2025-01-01 12:00:00 some long message text, more", "%[^,]%n", u8_str, &n);
+		status += CHECK_STRING(u8_str, "2025-01-01 12:00:00 some long message text");
+		status += CHECK_UVALUE(n, 42);
+		status += CHECK_RESULT(result, 1);
+	}
+
 	// ------------------------------------------------------------------------------------
 
 	result = sscanf("abcd", "%l[abc]%n", u16_str, &n);
@@ -1235,6 +1280,113 @@ int test_suppress(void)
 	return status;
 }
 
+int test_stream(void)
+{
+	int status = 0;
+	int result = 0;
+	int value = 0;
+	int count = 0;
+	long long sum = 0;
+	char word[16] = {0};
+	FILE *f = NULL;
+	const char *filename = "t-fscanf";
+
+	f = fopen(filename, "w+");
+	ASSERT_NOTNULL(f);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		fprintf(f, "%d%c", i * 37 - 5000, (i % 8 == 7) ? '\n' : ' ');
+	}
+
+	fprintf(f, "end:%s", "done!");
+	fseek(f, 0, SEEK_SET);
+
+	// Numbers straddle the buffer boundaries.
+	setvbuf(f, NULL, _IOFBF, 16);
+
+	while ((result = fscanf(f, "%d", &value)) == 1)
+	{
+		sum += value;
+		count += 1;
+	}
+
+	status += CHECK_RESULT(result, 0);
+	status += CHECK_RESULT(count, 1000);
+	status += CHECK_IVALUE(sum, 13481500);
+
+	result = fscanf(f, "end:%4s", word);
+	status += CHECK_RESULT(result, 1);
+	status += CHECK_STRING(word, "done");
+
+	// Unconsumed input is left in the stream.
+	result = fgetc(f);
+	status += CHECK_RESULT(result, '!');
+
+	result = fscanf(f, "%d", &value);
+	status += CHECK_RESULT(result, EOF);
+
+	ASSERT_SUCCESS(fclose(f));
+	ASSERT_SUCCESS(unlink(filename));
+
+	return status;
+}
+
+int test_stream_unbuffered(void)
+{
+	int status = 0;
+	int result = 0;
+	int value = 0;
+	char ch = 0;
+	float f32 = 0;
+	int fds[2];
+	FILE *f = NULL;
+
+	ASSERT_SUCCESS(pipe(fds));
+	ASSERT_EQ(write(fds[1], "12 34x 1e5 1e+z", 15), 15);
+	ASSERT_SUCCESS(close(fds[1]));
+
+	f = fdopen(fds[0], "r");
+	ASSERT_NOTNULL(f);
+	ASSERT_SUCCESS(setvbuf(f, NULL, _IONBF, 0));
+
+	// Lookahead can not be given back to the pipe, it is kept in the stream.
+	result = fscanf(f, "%d", &value);
+	status += CHECK_RESULT(result, 1);
+	status += CHECK_IVALUE(value, 12);
+
+	result = fgetc(f);
+	status += CHECK_RESULT(result, ' ');
+
+	result = fscanf(f, "%d%c", &value, &ch);
+	status += CHECK_RESULT(result, 2);
+	status += CHECK_IVALUE(value, 34);
+	status += CHECK_RESULT(ch, 'x');
+
+	result = fscanf(f, "%f", &f32);
+	status += CHECK_RESULT(result, 1);
+	status += CHECK_FLOAT32(f32, 1e5);
+
+	// The exponent is not consumed without digits.
+	result = fscanf(f, "%f", &f32);
+	status += CHECK_RESULT(result, 1);
+	status += CHECK_FLOAT32(f32, 1.0);
+
+	result = fgetc(f);
+	status += CHECK_RESULT(result, 'e');
+
+	result = fscanf(f, "+%c", &ch);
+	status += CHECK_RESULT(result, 1);
+	status += CHECK_RESULT(ch, 'z');
+
+	result = fgetc(f);
+	status += CHECK_RESULT(result, EOF);
+
+	ASSERT_SUCCESS(fclose(f));
+
+	return status;
+}
+
 #pragma warning(pop)
 
 #ifdef __clang__
@@ -1257,6 +1409,8 @@ int main()
 	TEST(test_position());
 	TEST(test_overflow());
 	TEST(test_suppress());
+	TEST(test_stream());
+	TEST(test_stream_unbuffered());
 
 	VERIFY_RESULT_AND_EXIT();
 }
@@ -9,6 +9,8 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdio_ext.h>
+#include <stdlib.h>
+#include <string.h>
 
 int test_buffer()
 {
@@ -143,11 +145,98 @@ int test_pending()
 	return 0;
 }
 
+int test_mapped()
+{
+	int result;
+	int number;
+	size_t size;
+	size_t count;
+	size_t line_size = 0;
+	ssize_t length;
+	const char *ptr;
+	char *line = NULL;
+	char word[8];
+	char buffer[16];
+	FILE *stream;
+	const char *filename = "t-mapped";
+	const char *content = "line one\nline two\n42 end";
+
+	stream = fopen(filename, "w");
+	ASSERT_NOTNULL(stream);
+	ASSERT_EQ(fputs(content, stream), 0);
+	ASSERT_SUCCESS(fclose(stream));
+
+	stream = fopen(filename, "rm");
+	ASSERT_NOTNULL(stream);
+	ASSERT_NOTEQ(fileno(stream), -1);
+
+	// The whole file is available.
+	ptr = __fbufptr(stream, &size);
+	ASSERT_EQ(size, strlen(content));
+	ASSERT_MEMEQ(ptr, content, size);
+
+	result = fgetc(stream);
+	ASSERT_EQ(result, 'l');
+
+	length = getline(&line, &line_size, stream);
+	ASSERT_EQ(length, 8);
+	ASSERT_STREQ(line, "ine one\n");
+
+	ptr = __fbufptr(stream, &size);
+	ASSERT_EQ(size, 15);
+	ASSERT_MEMEQ(ptr, "line two\n", 9);
+
+	__freadptrinc(stream, 5);
+
+	ASSERT_NOTNULL(fgets(buffer, 16, stream));
+	ASSERT_STREQ(buffer, "two\n");
+
+	result = fscanf(stream, "%d %7s", &number, word);
+	ASSERT_EQ(result, 2);
+	ASSERT_EQ(number, 42);
+	ASSERT_STREQ(word, "end");
+
+	result = fgetc(stream);
+	ASSERT_EQ(result, EOF);
+	ASSERT_EQ(feof(stream), 1);
+
+	ptr = __fbufptr(stream, &size);
+	ASSERT_NULL(ptr);
+	ASSERT_EQ(size, 0);
+
+	ASSERT_SUCCESS(fseek(stream, 5, SEEK_SET));
+	count = fread(buffer, 1, 3, stream);
+	ASSERT_EQ(count, 3);
+	ASSERT_MEMEQ(buffer, "one", 3);
+
+	// Read only.
+	count = fwrite("x", 1, 1, stream);
+	ASSERT_EQ(count, 0);
+
+	ASSERT_SUCCESS(fclose(stream));
+	free(line);
+
+	// Empty files are read normally.
+	stream = fopen(filename, "w");
+	ASSERT_NOTNULL(stream);
+	ASSERT_SUCCESS(fclose(stream));
+
+	stream = fopen(filename, "rm");
+	ASSERT_NOTNULL(stream);
+	ASSERT_EQ(fgetc(stream), EOF);
+	ASSERT_SUCCESS(fclose(stream));
+
+	ASSERT_SUCCESS(remove(filename));
+
+	return 0;
+}
+
 void cleanup()
 {
 	remove("t-buffer");
 	remove("t-mode");
 	remove("t-pending");
+	remove("t-mapped");
 }
 
 int main()
@@ -158,6 +247,7 @@ int main()
 	TEST(test_buffer());
 	TEST(test_mode());
 	TEST(test_pending());
+	TEST(test_mapped());
 
 	VERIFY_RESULT_AND_EXIT();
 }
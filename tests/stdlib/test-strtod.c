@@ -0,0 +1,214 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#include <tests/test.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t to_bits(double value)
+{
+	uint64_t bits = 0;
+	memcpy(&bits, &value, sizeof(double));
+	return bits;
+}
+
+static uint32_t to_bits32(float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(float));
+	return bits;
+}
+
+int test_strtod_basic()
+{
+	char *end = NULL;
+	const char *str = NULL;
+
+	str = "1.5";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(1.5));
+	ASSERT_EQ(end, str + 3);
+
+	str = "  -0.125xyz";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(-0.125));
+	ASSERT_EQ(end, str + 8);
+
+	str = "1e10";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(1e10));
+	ASSERT_EQ(end, str + 4);
+
+	str = "2.5E-3";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(2.5e-3));
+	ASSERT_EQ(end, str + 6);
+
+	// The exponent is not consumed without digits
+	str = "7e+";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(7.0));
+	ASSERT_EQ(end, str + 1);
+
+	str = "0x1.8p1";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(3.0));
+	ASSERT_EQ(end, str + 7);
+
+	str = "abc";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(0.0));
+	ASSERT_EQ(end, str);
+
+	str = ".";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(0.0));
+	ASSERT_EQ(end, str);
+
+	return 0;
+}
+
+int test_strtod_rounding()
+{
+	// Decimal to binary conversion is correctly rounded.
+	ASSERT_EQ(to_bits(strtod("0.1", NULL)), 0x3FB999999999999A);
+
+	// 2^53 + 1 is halfway between two doubles
+	ASSERT_EQ(to_bits(strtod("9007199254740993", NULL)), 0x4340000000000000);
+	ASSERT_EQ(to_bits(strtod("9007199254740993.0000000001", NULL)), 0x4340000000000001);
+
+	ASSERT_EQ(to_bits(strtod("1.7976931348623157e308", NULL)), 0x7FEFFFFFFFFFFFFF);
+	ASSERT_EQ(to_bits(strtod("2.2250738585072011e-308", NULL)), 0x000FFFFFFFFFFFFF);
+	ASSERT_EQ(to_bits(strtod("4.9406564584124654e-324", NULL)), 0x0000000000000001);
+	ASSERT_EQ(to_bits(strtod("2.4703282292062328e-324", NULL)), 0x0000000000000001);
+	ASSERT_EQ(to_bits(strtod("2.4703282292062327e-324", NULL)), 0x0000000000000000);
+	ASSERT_EQ(to_bits(strtod("123456789012345678901234567890", NULL)), 0x45F8EE90FF6C373E);
+	ASSERT_EQ(to_bits(strtod("0.000000000000000000000000000000000000001234567890123456789012345", NULL)), 0x37DAE2F22C33F119);
+
+	// Exact halfway point between 1 and the next double, and just above it.
+	ASSERT_EQ(to_bits(strtod("1.00000000000000011102230246251565404236316680908203125", NULL)), 0x3FF0000000000000);
+	ASSERT_EQ(to_bits(strtod("1.000000000000000111022302462515654042363166809082031250000000000000001", NULL)),
+			  0x3FF0000000000001);
+
+	return 0;
+}
+
+int test_strtod_range()
+{
+	errno = 0;
+	ASSERT_EQ(to_bits(strtod("1e309", NULL)), 0x7FF0000000000000);
+	ASSERT_ERRNO(ERANGE);
+
+	errno = 0;
+	ASSERT_EQ(to_bits(strtod("-1e400", NULL)), 0xFFF0000000000000);
+	ASSERT_ERRNO(ERANGE);
+
+	errno = 0;
+	ASSERT_EQ(to_bits(strtod("1e-400", NULL)), 0x0000000000000000);
+	ASSERT_ERRNO(ERANGE);
+
+	errno = 0;
+	ASSERT_EQ(to_bits(strtod("inf", NULL)), 0x7FF0000000000000);
+	ASSERT_ERRNO(0);
+
+	return 0;
+}
+
+int test_strtof_rounding()
+{
+	ASSERT_EQ(to_bits32(strtof("0.1", NULL)), 0x3DCCCCCD);
+
+	// The nearest double is exactly halfway between 1 and the next float, the float must not be rounded from it.
+	ASSERT_EQ(to_bits32(strtof("1.0000000596046447755", NULL)), 0x3F800001);
+	ASSERT_EQ(to_bits32(strtof("1.0000000596046447753", NULL)), 0x3F800000);
+
+	// Exact halfway points round to even.
+	ASSERT_EQ(to_bits32(strtof("1.000000059604644775390625", NULL)), 0x3F800000);
+	ASSERT_EQ(to_bits32(strtof("1.000000178813934326171875", NULL)), 0x3F800002);
+	ASSERT_EQ(to_bits32(strtof("16777217", NULL)), 0x4B800000);
+	ASSERT_EQ(to_bits32(strtof("16777219", NULL)), 0x4B800002);
+
+	ASSERT_EQ(to_bits32(strtof("3.4028235677973366e38", NULL)), 0x7F7FFFFF);
+	ASSERT_EQ(to_bits32(strtof("1.1754942e-38", NULL)), 0x007FFFFF);
+	ASSERT_EQ(to_bits32(strtof("7.0064923216240854e-46", NULL)), 0x00000001);
+	ASSERT_EQ(to_bits32(strtof("7.0064923216240853e-46", NULL)), 0x00000000);
+
+	errno = 0;
+	ASSERT_EQ(to_bits32(strtof("3.4028235677973367e38", NULL)), 0x7F800000);
+	ASSERT_ERRNO(ERANGE);
+
+	errno = 0;
+	ASSERT_EQ(to_bits32(strtof("-1e-46", NULL)), 0x80000000);
+	ASSERT_ERRNO(ERANGE);
+
+	return 0;
+}
+
+int test_strtod_partial()
+{
+	char *end = NULL;
+	const char *str = NULL;
+
+	// Only the leading zero is a number.
+	str = "0x";
+	ASSERT_EQ(to_bits(strtod(str, &end)), 0x0000000000000000);
+	ASSERT_EQ(end, str + 1);
+
+	str = "-0xg";
+	ASSERT_EQ(to_bits(strtod(str, &end)), 0x8000000000000000);
+	ASSERT_EQ(end, str + 2);
+
+	str = "0x.p1";
+	ASSERT_EQ(to_bits(strtod(str, &end)), 0x0000000000000000);
+	ASSERT_EQ(end, str + 1);
+
+	// Exponent without digits.
+	str = "0x1p+";
+	ASSERT_EQ(to_bits(strtod(str, &end)), to_bits(1.0));
+	ASSERT_EQ(end, str + 3);
+
+	str = "nan(123)";
+	strtod(str, &end);
+	ASSERT_EQ(end, str + 8);
+
+	str = "-NAN(abc_1)x";
+	strtof(str, &end);
+	ASSERT_EQ(end, str + 11);
+
+	// Unterminated sequence.
+	str = "nan(12";
+	strtod(str, &end);
+	ASSERT_EQ(end, str + 3);
+
+	str = "nan(1-2)";
+	strtod(str, &end);
+	ASSERT_EQ(end, str + 3);
+
+	return 0;
+}
+
+int test_strntod()
+{
+	char *end = NULL;
+	const char *str = "3.14159";
+
+	ASSERT_EQ(to_bits(strntod(str, 4, &end)), to_bits(3.14));
+	ASSERT_EQ(end, str + 4);
+
+	ASSERT_EQ(to_bits(strntof(str, 1, &end)), to_bits(3.0));
+	ASSERT_EQ(end, str + 1);
+
+	ASSERT_EQ(to_bits(strtof("0.1", NULL)), to_bits(0.1f));
+
+	return 0;
+}
+
+int main()
+{
+	INITIAILIZE_TESTS();
+
+	TEST(test_strtod_basic());
+	TEST(test_strtod_rounding());
+	TEST(test_strtod_range());
+	TEST(test_strtof_rounding());
+	TEST(test_strtod_partial());
+	TEST(test_strntod());
+
+	VERIFY_RESULT_AND_EXIT();
+}
@@ -0,0 +1,245 @@
+/*
+   Copyright (c) 2020-2025 Sibi Siddharthan
+
+   Distributed under the MIT license.
+   Refer to the LICENSE file at the root directory for details.
+*/
+
+#include <tests/test.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+int test_readv_writev()
+{
+	int fd;
+	ssize_t result;
+	char rbuf1[4], rbuf2[8], rbuf3[16];
+	struct iovec iov[3];
+	const char *filename = "t-uio";
+
+	fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0700);
+	ASSERT_NOTEQ(fd, -1);
+
+	iov[0].iov_base = "hello";
+	iov[0].iov_len = 5;
+	iov[1].iov_base = NULL;
+	iov[1].iov_len = 0;
+	iov[2].iov_base = " world\n";
+	iov[2].iov_len = 7;
+
+	result = writev(fd, iov, 3);
+	ASSERT_EQ(result, 12);
+	ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 12);
+
+	lseek(fd, 0, SEEK_SET);
+
+	iov[0].iov_base = rbuf1;
+	iov[0].iov_len = 4;
+	iov[1].iov_base = rbuf2;
+	iov[1].iov_len = 4;
+	iov[2].iov_base = rbuf3;
+	iov[2].iov_len = 16;
+
+	result = readv(fd, iov, 3);
+	ASSERT_EQ(result, 12);
+	ASSERT_MEMEQ(rbuf1, "hell", 4);
+	ASSERT_MEMEQ(rbuf2, "o wo", 4);
+	ASSERT_MEMEQ(rbuf3, "rld\n", 4);
+	ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 12);
+
+	// Bad vectors
+	ASSERT_FAIL(writev(fd, iov, -1));
+	ASSERT_ERRNO(EINVAL);
+	ASSERT_FAIL(writev(fd, NULL, 1));
+	ASSERT_ERRNO(EFAULT);
+
+	ASSERT_SUCCESS(close(fd));
+
+	ASSERT_FAIL(readv(fd, iov, 3));
+	ASSERT_ERRNO(EBADF);
+
+	ASSERT_SUCCESS(unlink(filename));
+
+	return 0;
+}
+
+int test_preadv_pwritev()
+{
+	int fd;
+	ssize_t result;
+	char rbuf1[4], rbuf2[8];
+	struct iovec iov[2];
+	const char *filename = "t-puio";
+
+	fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0700);
+	ASSERT_NOTEQ(fd, -1);
+
+	result = write(fd, "0123456789", 10);
+	ASSERT_EQ(result, 10);
+
+	iov[0].iov_base = "ab";
+	iov[0].iov_len = 2;
+	iov[1].iov_base = "cd";
+	iov[1].iov_len = 2;
+
+	result = pwritev(fd, iov, 2, 3);
+	ASSERT_EQ(result, 4);
+	ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 10);
+
+	iov[0].iov_base = rbuf1;
+	iov[0].iov_len = 4;
+	iov[1].iov_base = rbuf2;
+	iov[1].iov_len = 8;
+
+	result = preadv(fd, iov, 2, 1);
+	ASSERT_EQ(result, 9);
+	ASSERT_MEMEQ(rbuf1, "12ab", 4);
+	ASSERT_MEMEQ(rbuf2, "cd789", 5);
+	ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 10);
+
+	ASSERT_FAIL(preadv(fd, iov, 2, -1));
+	ASSERT_ERRNO(EINVAL);
+
+	// -1 is the current position.
+	lseek(fd, 8, SEEK_SET);
+	result = preadv2(fd, iov, 2, -1, 0);
+	ASSERT_EQ(result, 2);
+	ASSERT_MEMEQ(rbuf1, "89", 2);
+	ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 10);
+
+	iov[0].iov_base = "xy";
+	iov[0].iov_len = 2;
+	iov[1].iov_base = "z";
+	iov[1].iov_len = 1;
+
+	result = pwritev2(fd, iov, 2, 0, RWF_APPEND | RWF_DSYNC);
+	ASSERT_EQ(result, 3);
+	ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 10);
+
+	result = pread(fd, rbuf2, 8, 8);
+	ASSERT_EQ(result, 5);
+	ASSERT_MEMEQ(rbuf2, "89xyz", 5);
+
+	ASSERT_FAIL(pwritev2(fd, iov, 2, 0, RWF_NOWAIT));
+	ASSERT_ERRNO(EOPNOTSUPP);
+
+	ASSERT_SUCCESS(close(fd));
+	ASSERT_SUCCESS(unlink(filename));
+
+	return 0;
+}
+
+int test_uio_large()
+{
+	int fd;
+	ssize_t result;
+	char *buffer1, *buffer2, *check;
+	size_t size = 65536;
+	struct iovec iov[2];
+	const char *filename = "t-uio-large";
+
+	buffer1 = malloc(size);
+	buffer2 = malloc(size);
+	check = malloc(size * 2);
+
+	ASSERT_NOTNULL(buffer1);
+	ASSERT_NOTNULL(buffer2);
+	ASSERT_NOTNULL(check);
+
+	memset(buffer1, 'a', size);
+	memset(buffer2, 'b', size);
+
+	fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0700);
+	ASSERT_NOTEQ(fd, -1);
+
+	// Too large to be gathered.
+	iov[0].iov_base = buffer1;
+	iov[0].iov_len = size;
+	iov[1].iov_base = buffer2;
+	iov[1].iov_len = size;
+
+	result = writev(fd, iov, 2);
+	ASSERT_EQ(result, size * 2);
+
+	result = pread(fd, check, size * 2, 0);
+	ASSERT_EQ(result, size * 2);
+	ASSERT_MEMEQ(check, buffer1, size);
+	ASSERT_MEMEQ(check + size, buffer2, size);
+
+	memset(buffer1, 0, size);
+	memset(buffer2, 0, size);
+
+	result = preadv(fd, iov, 2, 0);
+	ASSERT_EQ(result, size * 2);
+	ASSERT_MEMEQ(buffer1, check, size);
+	ASSERT_MEMEQ(buffer2, check + size, size);
+
+	ASSERT_SUCCESS(close(fd));
+	ASSERT_SUCCESS(unlink(filename));
+
+	free(buffer1);
+	free(buffer2);
+	free(check);
+
+	return 0;
+}
+
+int test_uio_pipe()
+{
+	int fds[2];
+	ssize_t result;
+	char rbuf1[4], rbuf2[16];
+	struct iovec iov[2];
+
+	ASSERT_SUCCESS(pipe(fds));
+
+	iov[0].iov_base = "abc";
+	iov[0].iov_len = 3;
+	iov[1].iov_base = "defgh";
+	iov[1].iov_len = 5;
+
+	result = writev(fds[1], iov, 2);
+	ASSERT_EQ(result, 8);
+
+	ASSERT_FAIL(pwritev(fds[1], iov, 2, 0));
+	ASSERT_ERRNO(ESPIPE);
+
+	iov[0].iov_base = rbuf1;
+	iov[0].iov_len = 4;
+	iov[1].iov_base = rbuf2;
+	iov[1].iov_len = 16;
+
+	result = readv(fds[0], iov, 2);
+	ASSERT_EQ(result, 8);
+	ASSERT_MEMEQ(rbuf1, "abcd", 4);
+	ASSERT_MEMEQ(rbuf2, "efgh", 4);
+
+	ASSERT_SUCCESS(close(fds[0]));
+	ASSERT_SUCCESS(close(fds[1]));
+
+	return 0;
+}
+
+void cleanup()
+{
+	remove("t-uio");
+	remove("t-puio");
+	remove("t-uio-large");
+}
+
+int main()
+{
+	INITIAILIZE_TESTS();
+	CLEANUP(cleanup);
+
+	TEST(test_readv_writev());
+	TEST(test_preadv_pwritev());
+	TEST(test_uio_large());
+	TEST(test_uio_pipe());
+
+	VERIFY_RESULT_AND_EXIT();
+}